@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// Skyline packing of Atlas::addRect() for Latin, CJK and mixed glyph sets:
+// time per glyph and the part of the used pages covered by glyphs. Glyphs
+// go to the first page with room, as in GlyphAtlas, in the order they
+// arrive and sorted by height.
+// Glyph sizes are synthetic, from 10 to 40 px with one pixel of padding.
+
+#include "alfons/atlas.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace alfons;
+
+namespace {
+
+struct Size {
+    int w, h;
+};
+
+// Latin: narrow to wide advances, heights of x-height, ascender,
+// descender and punctuation
+std::vector<Size> latinSet(std::mt19937& _rng) {
+    const float heights[] = { .52f, .52f, .72f, .72f, .7f, .95f, .2f };
+    std::vector<Size> set;
+    for (int size = 10; size <= 40; size += 2) {
+        for (int i = 0; i < 200; i++) {
+            float w = size * (.2f + (_rng() % 60) / 100.f);
+            float h = size * heights[_rng() % 7];
+            set.push_back({ int(w) + 2, int(h) + 2 });
+        }
+    }
+    return set;
+}
+
+// CJK: ideographs close to the em square
+std::vector<Size> cjkSet(std::mt19937& _rng) {
+    std::vector<Size> set;
+    for (int size = 10; size <= 40; size += 2) {
+        for (int i = 0; i < 500; i++) {
+            set.push_back({ size * int(90 + _rng() % 12) / 100 + 2,
+                            size * int(88 + _rng() % 14) / 100 + 2 });
+        }
+    }
+    return set;
+}
+
+struct Result {
+    double ns;
+    size_t pages;
+    double fill;
+};
+
+Result pack(const std::vector<Size>& _glyphs, int _pageSize) {
+    Result result{ 1e30, 0, 0 };
+
+    for (int run = 0; run < 5; run++) {
+        std::vector<Atlas> pages;
+        // Allocate pages outside of the timed part
+        pages.reserve(result.pages);
+        for (size_t i = 0; i < result.pages; i++) { pages.emplace_back(_pageSize, _pageSize); }
+        size_t used = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (auto& glyph : _glyphs) {
+            int x, y;
+            size_t page = 0;
+            while (page < used && !pages[page].addRect(glyph.w, glyph.h, &x, &y)) { page++; }
+            if (page < used) { continue; }
+
+            if (used == pages.size()) { pages.emplace_back(_pageSize, _pageSize); }
+            pages[used++].addRect(glyph.w, glyph.h, &x, &y);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        // The first run only counts pages
+        if (run > 0) {
+            result.ns = std::min(result.ns, std::chrono::duration<double, std::nano>(end - start).count() / _glyphs.size());
+        }
+        result.pages = used;
+        benchSink += used;
+    }
+
+    double area = 0;
+    for (auto& glyph : _glyphs) { area += glyph.w * glyph.h; }
+    result.fill = area / (double(result.pages) * _pageSize * _pageSize);
+
+    return result;
+}
+
+}
+
+int main() {
+    std::mt19937 rng(7);
+
+    auto latin = latinSet(rng);
+    auto cjk = cjkSet(rng);
+
+    std::vector<Size> mixed;
+    for (size_t i = 0; i < latin.size() + cjk.size(); i++) {
+        mixed.push_back(rng() % 2 ? latin[rng() % latin.size()] : cjk[rng() % cjk.size()]);
+    }
+
+    struct {
+        const char* name;
+        std::vector<Size>& glyphs;
+    } sets[] = { { "latin", latin }, { "cjk", cjk }, { "mixed", mixed } };
+
+    std::printf("page  set    order   glyphs   ns/glyph  pages  fill\n");
+
+    for (int pageSize : { 512, 1024 }) {
+        for (auto& set : sets) {
+            for (bool sorted : { false, true }) {
+                auto glyphs = set.glyphs;
+                if (sorted) {
+                    std::sort(glyphs.begin(), glyphs.end(), [](Size a, Size b) {
+                        return a.h != b.h ? a.h > b.h : a.w > b.w;
+                    });
+                }
+                Result r = pack(glyphs, pageSize);
+
+                std::printf("%4d  %-5s  %-6s  %6zu  %9.1f  %5zu  %4.1f%%\n", pageSize, set.name,
+                            sorted ? "sorted" : "stream", glyphs.size(), r.ns, r.pages, r.fill * 100);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+// Results are added to benchSink so that the timed work is not optimized out
+static volatile size_t benchSink = 0;
+
+// Best time of @runs calls of @f, in nanoseconds per one of @count items
+template <class F>
+double measure(size_t count, F f, int runs = 5) {
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    return best / count;
+}
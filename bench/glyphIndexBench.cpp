@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// Glyph lookup with 1, 4 and 16 atlas pages: GlyphIndex over one record
+// store, as GlyphAtlas::findGlyph(), against one unordered_map per page
+// probed in turn, as before the index.
+
+#include "alfons/glyphIndex.h"
+#include "bench.h"
+
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace alfons;
+
+namespace {
+
+struct Key {
+    uint32_t font, codepoint;
+
+    bool operator==(const Key& other) const {
+        return font == other.font && codepoint == other.codepoint;
+    }
+    uint64_t packed() const { return uint64_t(font) << 32 | codepoint; }
+};
+
+// Hash of the former per-page maps
+struct KeyHash {
+    size_t operator()(const Key& k) const {
+        return (std::hash<uint32_t>()(k.font) ^ std::hash<uint32_t>()(k.codepoint) << 1) >> 1;
+    }
+};
+
+struct Record {
+    float offset[2], size[2];
+    uint16_t u1, v1, u2, v2;
+};
+
+}
+
+int main() {
+    const int glyphsPerPage = 400;
+    const int faces = 6;
+    const size_t lookups = 4000000;
+
+    std::mt19937 rng(1);
+
+    std::printf("pages glyphs  per-page maps  global index\n");
+
+    for (int pages : { 1, 4, 16 }) {
+        int count = pages * glyphsPerPage;
+
+        std::vector<Key> keys;
+        for (int i = 0; i < count; i++) {
+            keys.push_back({ uint32_t(i % faces), uint32_t(30 + i / faces) });
+        }
+
+        std::vector<std::unordered_map<Key, Record, KeyHash>> pageMaps(pages);
+        std::deque<Record> records;
+        GlyphIndex index;
+
+        for (int i = 0; i < count; i++) {
+            Record record{ { 0, 0 }, { 0, 0 }, uint16_t(i), 0, 0, 0 };
+            pageMaps[i / glyphsPerPage].emplace(keys[i], record);
+            records.push_back(record);
+            index.insert(keys[i].packed(), i);
+        }
+
+        std::vector<Key> queries;
+        for (size_t i = 0; i < lookups; i++) { queries.push_back(keys[rng() % count]); }
+
+        double maps = measure(lookups, [&]() {
+            size_t sum = 0;
+            for (auto& key : queries) {
+                size_t page = 0;
+                for (auto& map : pageMaps) {
+                    auto it = map.find(key);
+                    if (it != map.end()) {
+                        sum += page + it->second.u1;
+                        break;
+                    }
+                    page++;
+                }
+            }
+            benchSink += sum;
+        });
+
+        double global = measure(lookups, [&]() {
+            size_t sum = 0;
+            for (auto& key : queries) {
+                uint32_t i = index.find(key.packed());
+                sum += i + records[i].u1;
+            }
+            benchSink += sum;
+        });
+
+        std::printf("%5d %6d %11.1f ns %10.1f ns\n", pages, count, maps, global);
+    }
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// multiChannelDistanceField() of an 'O' with a 'T' across it, in ns per
+// output pixel at three sizes.
+
+#include "alfons/msdf.h"
+#include "bench.h"
+
+#include FT_OUTLINE_H
+
+#include <cmath>
+#include <cstdio>
+
+using namespace alfons;
+
+// Two rings of 8 conic arcs and a polygon, @size pixels
+static void makeOutline(FT_Library _library, float _size, FT_Outline& _outline) {
+    const int arcs = 8;
+    const float pi = 3.14159265f;
+    const float bar[8][2] = { { 0, 1 }, { 1, 1 }, { 1, .9f }, { .55f, .9f },
+                              { .55f, 0 }, { .45f, 0 }, { .45f, .9f }, { 0, .9f } };
+
+    FT_Outline_New(_library, 4 * arcs + 8, 3, &_outline);
+
+    int n = 0;
+    for (int c = 0; c < 2; c++) {
+        float r = _size * (c ? 0.22f : 0.4f);
+        for (int i = 0; i < 2 * arcs; i++) {
+            // Outer ring clockwise, inner counter-clockwise
+            float a = (c ? 1 : -1) * pi * i / arcs;
+            float d = (i % 2) ? r / std::cos(pi / (2 * arcs)) : r;
+            _outline.points[n].x = FT_Pos((_size / 2 + d * std::cos(a)) * 64);
+            _outline.points[n].y = FT_Pos((_size / 2 + d * std::sin(a)) * 64);
+            _outline.tags[n++] = (i % 2) ? FT_CURVE_TAG_CONIC : FT_CURVE_TAG_ON;
+        }
+        _outline.contours[c] = short(n - 1);
+    }
+    for (auto& p : bar) {
+        _outline.points[n].x = FT_Pos(p[0] * _size * 64);
+        _outline.points[n].y = FT_Pos(p[1] * _size * 64);
+        _outline.tags[n++] = FT_CURVE_TAG_ON;
+    }
+    _outline.contours[2] = short(n - 1);
+}
+
+int main() {
+    FT_Library library;
+    FT_Init_FreeType(&library);
+
+    std::printf(" size  ns/pixel\n");
+
+    for (float size : { 24.f, 48.f, 96.f }) {
+        FT_Outline outline;
+        makeOutline(library, size, outline);
+
+        GlyphBitmap field;
+        multiChannelDistanceField(outline, 4, field);
+        size_t pixels = field.width() * field.height();
+
+        const int repeat = 20;
+        double ns = measure(pixels * repeat, [&]() {
+            for (int i = 0; i < repeat; i++) {
+                multiChannelDistanceField(outline, 4, field);
+                benchSink += field.buffer[0];
+            }
+        });
+        std::printf("%5.0f  %8.1f\n", size, ns);
+
+        FT_Outline_Done(library, &outline);
+    }
+
+    FT_Done_FreeType(library);
+    return 0;
+}
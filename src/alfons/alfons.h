@@ -2,6 +2,15 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ALFONS_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ALFONS_NEON
+#endif
 
 namespace alfons {
 
@@ -29,12 +38,81 @@ struct Rect {
 struct MeshCallback {
     virtual void drawGlyph(const Quad& quad, const AtlasGlyph& glyph) = 0;
     virtual void drawGlyph(const Rect& rect, const AtlasGlyph& glyph) = 0;
+
+    // Glyph with its halo glyph (see TextBatch::setHalo), e.g. for one quad
+    // sampling both. The default draws the halo, then the glyph.
+    virtual void drawGlyph(const Quad& quad, const AtlasGlyph& glyph,
+                           const Quad& haloQuad, const AtlasGlyph& halo) {
+        drawGlyph(haloQuad, halo);
+        drawGlyph(quad, glyph);
+    }
+    virtual void drawGlyph(const Rect& rect, const AtlasGlyph& glyph,
+                           const Rect& haloRect, const AtlasGlyph& halo) {
+        drawGlyph(haloRect, halo);
+        drawGlyph(rect, glyph);
+    }
 };
 
+enum class TextureFormat : uint8_t {
+    // 8 bit coverage or distance
+    alpha,
+    // 3 bytes per pixel, multi-channel distance field
+    rgb,
+    // 4 bytes per pixel, premultiplied BGRA color glyphs
+    bgra
+};
+
+inline int bytesPerPixel(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::rgb: return 3;
+    case TextureFormat::bgra: return 4;
+    default: return 1;
+    }
+}
+
 struct TextureCallback {
     virtual void addTexture(AtlasID id, uint16_t textureWidth, uint16_t textureHeight) = 0;
+
+    // Called instead of the above for textures that are not TextureFormat::alpha.
+    // The glyph data passed to addGlyph() has the bytes per pixel of @format.
+    virtual void addTexture(AtlasID id, uint16_t textureWidth, uint16_t textureHeight,
+                            TextureFormat /*format*/) {
+        addTexture(id, textureWidth, textureHeight);
+    }
+
     virtual void addGlyph(AtlasID id, uint16_t gx, uint16_t gy, uint16_t gw, uint16_t gh,
                           const unsigned char* src, uint16_t padding) = 0;
+
+    // Called once per modified texture by GlyphAtlas::update() when uploads
+    // are batched. @src points to the first pixel of the region, rows are
+    // @stride bytes apart (i.e. GL_UNPACK_ROW_LENGTH is stride / bytesPerPixel).
+    // The default passes a tightly packed copy of the region to addGlyph().
+    virtual void updateTexture(AtlasID id, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                               const unsigned char* src, size_t stride, TextureFormat format) {
+        size_t row = w * bytesPerPixel(format);
+        std::vector<unsigned char> region(row * h);
+        for (uint16_t i = 0; i < h; i++) {
+            memcpy(&region[i * row], src + i * stride, row);
+        }
+        addGlyph(id, x, y, w, h, region.data(), 0);
+    }
+
+    // Texture @id was enlarged to @textureWidth x @textureHeight, see
+    // GlyphAtlas::setMaxTextureSize(). Glyph positions in pixels do not change;
+    // the whole texture content is uploaded again afterwards. The default
+    // creates the texture anew.
+    virtual void resizeTexture(AtlasID id, uint16_t textureWidth, uint16_t textureHeight,
+                               TextureFormat format) {
+        if (format == TextureFormat::alpha) {
+            addTexture(id, textureWidth, textureHeight);
+        } else {
+            addTexture(id, textureWidth, textureHeight, format);
+        }
+    }
+
+    // Texture @id is no longer used by the atlas, see GlyphAtlas::compact().
+    // Removed ids are always the highest ones.
+    virtual void removeTexture(AtlasID /*id*/) {}
 };
 
 #if 0
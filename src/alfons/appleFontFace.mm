@@ -91,6 +91,8 @@ bool AppleFontFace::load() {
                      dpi,       // horizontal_resolution
                      dpi);      // vertical_resolution
 
+    initGlyphFlags();
+
     // Set font metrics from cgFont and ctFont
     CTFontRef ctFont = CTFontCreateWithGraphicsFont(cgFont, m_baseSize, nullptr, nullptr);
 
@@ -4,22 +4,60 @@
 
 #include "atlas.h"
 #include "font.h"
+#include "lineLayout.h"
 
 #include "logger.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
 
 namespace alfons {
 
-Atlas::Atlas(int w, int h) {
+Atlas::Atlas(int w, int h, int _channels)
+    : channels(_channels) {
     reset(w, h);
 }
 
+void Atlas::setPixels(int x, int y, int w, int h, const unsigned char* src, int stride) {
+    size_t row = w * channels;
+    if (stride == 0) { stride = row; }
+
+    for (int i = 0; i < h; i++) {
+        memcpy(&pixels[((y + i) * width + x) * channels], src + i * stride, row);
+    }
+}
+
+void Atlas::markDirty(int x, int y, int w, int h) {
+    if (!isDirty()) {
+        dirty = { x, y, x + w, y + h };
+        return;
+    }
+    dirty.x0 = std::min(dirty.x0, x);
+    dirty.y0 = std::min(dirty.y0, y);
+    dirty.x1 = std::max(dirty.x1, x + w);
+    dirty.y1 = std::max(dirty.y1, y + h);
+}
+
 void Atlas::expand(int w, int h) {
     // Insert node for empty space
     if (w > width) {
-        nodes.insert(nodes.end(), {width, 0, w - width});
+        if (nodes.back().y == 0) {
+            nodes.back().width += w - width;
+        } else {
+            nodes.insert(nodes.end(), {width, 0, w - width});
+        }
+        lowest = 0;
+    }
+
+    std::vector<unsigned char> expanded(w * h * channels, 0);
+    size_t row = std::min(width, w) * channels;
+    for (int y = 0; y < std::min(height, h); y++) {
+        memcpy(&expanded[y * w * channels], &pixels[y * width * channels], row);
     }
+    pixels.swap(expanded);
+
     width = w;
     height = h;
 }
@@ -31,8 +69,10 @@ void Atlas::reset(int w, int h) {
     // Init root node.
     nodes.clear();
     nodes.push_back({0, 0, w});
+    lowest = 0;
 
-    glyphMap.clear();
+    pixels.assign(w * h * channels, 0);
+    dirty = { 0, 0, 0, 0 };
 }
 
 void Atlas::addSkylineLevel(uint32_t idx, int x, int y, int w, int h) {
@@ -40,49 +80,51 @@ void Atlas::addSkylineLevel(uint32_t idx, int x, int y, int w, int h) {
     // Insert new node
     nodes.insert(nodes.begin() + idx, {x, y + h, w});
 
-    // Delete skyline segments that fall under the shadow of the new segment.
-    for (size_t i = idx + 1; i < nodes.size(); i++) {
+    // Delete skyline segments that fall under the shadow of the new segment,
+    // and shrink the one that is partially covered.
+    int right = x + w;
 
-        int shrink = (nodes[i - 1].x + nodes[i - 1].width) - nodes[i].x;
-        if (shrink > 0) {
+    size_t end = idx + 1;
+    while (end < nodes.size() && nodes[end].x + nodes[end].width <= right) { end++; }
+    nodes.erase(nodes.begin() + idx + 1, nodes.begin() + end);
 
-            int nw = nodes[i].width - shrink;
-            if (nw > 0) {
-                nodes[i].x += shrink;
-                nodes[i].width = nw;
-                break;
-            } else {
-                nodes.erase(nodes.begin() + i);
-                i--;
-            }
-        } else { break; }
+    if (idx + 1 < nodes.size() && nodes[idx + 1].x < right) {
+        nodes[idx + 1].width -= right - nodes[idx + 1].x;
+        nodes[idx + 1].x = right;
     }
 
     // Merge same height skyline segments that are next to each other.
-    for (size_t i = 0; i < nodes.size() - 1; i++) {
-        if (nodes[i].y == nodes[i + 1].y) {
-            nodes[i].width += nodes[i + 1].width;
-            nodes.erase(nodes.begin() + i + 1);
-            i--;
-        }
+    // Other neighbors were already merged before.
+    if (idx + 1 < nodes.size() && nodes[idx + 1].y == nodes[idx].y) {
+        nodes[idx].width += nodes[idx + 1].width;
+        nodes.erase(nodes.begin() + idx + 1);
+    }
+    if (idx > 0 && nodes[idx - 1].y == nodes[idx].y) {
+        nodes[idx - 1].width += nodes[idx].width;
+        nodes.erase(nodes.begin() + idx);
     }
+
+    lowest = nodes[0].y;
+    for (auto& node : nodes) { lowest = std::min(lowest, node.y); }
 }
 
 /// Checks if there is enough space at the location of skyline span 'i', and
 /// return the max height of all skyline spans under that at that location,
 /// (think tetris block being dropped at that position). Or -1 if no space
-/// found.
-int Atlas::rectFits(uint32_t i, int w, int h) {
+/// found below @maxY.
+int Atlas::rectFits(uint32_t i, int w, int h, int maxY) const {
 
     if (nodes[i].x + w > width) { return -1; }
 
+    maxY = std::min(maxY, height);
+
     int spaceLeft = w;
     int y = nodes[i].y;
     while (spaceLeft > 0) {
         if (i == nodes.size()) { return -1; }
 
         y = std::max(y, nodes[i].y);
-        if (y + h > height) { return -1; }
+        if (y + h > maxY) { return -1; }
 
         spaceLeft -= nodes[i].width;
         ++i;
@@ -91,12 +133,21 @@ int Atlas::rectFits(uint32_t i, int w, int h) {
 }
 
 bool Atlas::addRect(int w, int h, int* rx, int* ry) {
+    // No position can be lower than the lowest skyline segment
+    if (w > width || lowest + h > height) { return false; }
+
     int besth = height, bestw = width;
     int bestx = -1, besty = -1, besti = -1;
 
     // Bottom left fit heuristic.
     for (size_t i = 0; i < nodes.size(); i++) {
-        int y = rectFits(i, w, h);
+        // Nodes are ordered by x: No later node leaves room for @w
+        if (nodes[i].x + w > width) { break; }
+
+        // Can not be better than the best fit so far
+        if (nodes[i].y + h > besth) { continue; }
+
+        int y = rectFits(i, w, h, besth);
         if (y != -1) {
             if ((y + h < besth) ||
                 ((y + h == besth) && (nodes[i].width < bestw))) {
@@ -120,38 +171,225 @@ bool Atlas::addRect(int w, int h, int* rx, int* ry) {
     return true;
 }
 
-bool GlyphAtlas::getGlyph(const Font& _font, const GlyphKey& _key, AtlasGlyph& _entry) {
-    AtlasID id = 0;
+GlyphAtlas::GlyphAtlas(TextureCallback& _textureCb, uint16_t _textureSize, int _glyphPadding)
+    : m_textureSize(_textureSize),
+      m_maxTextureSize(_textureSize),
+      m_padding(_glyphPadding),
+      m_textureCb(_textureCb) {}
 
-    for (auto& a : m_atlas) {
-        auto it = a.glyphMap.find(_key);
-        if (it != a.glyphMap.end()) {
-            //a->usage++;
-            _entry.atlas = id;
-            _entry.glyph = &it->second;
-            return true;
-        }
-        id++;
+GlyphAtlas::~GlyphAtlas() {
+    for (auto& entry : m_faces) {
+        if (entry.face) { entry.face->removeObserver(this); }
     }
-    return createGlyph(_font, _key, _entry);
 }
 
-bool GlyphAtlas::createGlyph(const Font& _font, const GlyphKey& _key, AtlasGlyph& _entry) {
+void GlyphAtlas::faceUnloaded(const FontFace& _face, bool _destroyed) {
+    // Unloaded faces are loaded again for rendering
+    if (!_destroyed) { return; }
 
-    if (_key.codepoint == 0) { return false; }
+    FaceID id = _face.id();
+    if (id >= m_faces.size() || m_faces[id].face != &_face) { return; }
 
-    auto& fontFace = _font.face(_key.font);
+    uint32_t glyphFont = m_faces[id].glyphFont;
+    m_faces[id] = FaceEntry();
 
-    const auto* gd = fontFace.createGlyph(_key.codepoint);
-    if (!gd) { return false; }
+    // Another face with this FaceID must not find the glyphs
+    if (!sharesGlyphs()) {
+        removeGlyphs(glyphFont);
+        return;
+    }
+
+    auto& shared = m_sources[glyphFont];
+    if (shared.source != &_face) { return; }
+
+    // Render shared glyphs with another face of the font from now on
+    shared.source = nullptr;
+    for (auto& entry : m_faces) {
+        if (!entry.face || entry.glyphFont != glyphFont) { continue; }
+
+        if (!shared.source) { shared.source = entry.face; }
+        entry.source = shared.source;
+    }
+
+    // No face can reach them any more
+    if (!shared.source) { removeGlyphs(glyphFont); }
+}
+
+void GlyphAtlas::removeGlyphs(uint32_t _glyphFont) {
+    for (uint32_t i = 0; i < m_glyphs.size(); i++) {
+        auto& record = m_glyphs[i];
+        if (record.atlas == GlyphIndex::npos || record.key.font != _glyphFont) { continue; }
+
+        m_glyphIndex.erase(record.key.packed());
+        record.atlas = GlyphIndex::npos;
+        record.version++;
+        m_freeGlyphs.push_back(i);
+    }
+    m_version++;
+}
+
+void GlyphAtlas::setDistanceField(float _referenceSize, int _spread, bool _multiChannel) {
+    m_sdfSize = _referenceSize;
+    m_sdfSpread = std::max(_spread, 1);
+    m_glyphFormat = _multiChannel ? GlyphFormat::msdf : GlyphFormat::sdf;
+}
+
+GlyphRasterizer& GlyphAtlas::rasterizer() {
+    if (m_rasterizer) { return *m_rasterizer; }
+
+    if (!m_localRasterizer) {
+        m_localRasterizer = std::make_unique<GlyphRasterizer>(0);
+    }
+    return *m_localRasterizer;
+}
+
+float GlyphAtlas::renderSize(float _faceSize) const {
+    if (isDistanceField()) { return m_sdfSize; }
+    if (m_sizeStep <= 0) { return _faceSize; }
+
+    // Small tolerance so that exact multiples are not rounded up
+    float bucket = std::ceil(_faceSize / m_sizeStep - 0.001f);
+    return std::max(bucket, 1.f) * m_sizeStep;
+}
+
+const GlyphAtlas::FaceEntry& GlyphAtlas::registerFace(const FontFace& _face) {
+    if (_face.id() >= m_faces.size()) {
+        m_faces.resize(_face.id() + 1);
+    }
+
+    auto& entry = m_faces[_face.id()];
+    if (entry.source) { return entry; }
+
+    _face.addObserver(this);
+    entry.face = &_face;
+
+    if (!sharesGlyphs()) {
+        entry.source = &_face;
+        entry.glyphFont = _face.id();
+        entry.size = _face.size();
+        return entry;
+    }
+
+    float size = renderSize(_face.size());
+
+    // Share glyphs between faces of the same font rendered at the same size
+    size_t source = 0;
+    for (; source < m_sources.size(); source++) {
+        if (m_sources[source].size == size && m_sources[source].source &&
+            m_sources[source].source->hasSameSource(_face)) { break; }
+    }
+    if (source == m_sources.size()) {
+        FaceEntry shared;
+        shared.source = &_face;
+        shared.glyphFont = source;
+        shared.size = size;
+        m_sources.push_back(shared);
+    }
+
+    entry.source = m_sources[source].source;
+    entry.glyphFont = source;
+    entry.scale = _face.size() / size;
+    entry.size = size;
+
+    return entry;
+}
+
+bool GlyphAtlas::storageKey(GlyphKey& _key, float& _scale) const {
+    _scale = 1;
+
+    if (!sharesGlyphs()) { return true; }
+
+    if (_key.font >= m_faces.size() || !m_faces[_key.font].source) {
+        return false;
+    }
+
+    auto& entry = m_faces[_key.font];
+    _key.font = entry.glyphFont;
+    _scale = entry.scale;
+
+    if (_key.stroke) {
+        _key.stroke = GlyphKey::strokeUnits(_key.strokeWidth() / entry.scale);
+    }
+    return true;
+}
+
+bool GlyphAtlas::findGlyph(const GlyphKey& _glyphKey, AtlasGlyph& _entry) {
+    GlyphKey key = _glyphKey;
+    if (!storageKey(key, _entry.scale)) { return false; }
+
+    uint32_t index = m_glyphIndex.find(key.packed());
+    if (index == GlyphIndex::npos) { return false; }
+
+    auto& record = m_glyphs[index];
+    _entry.atlas = record.atlas;
+    _entry.glyph = &record.glyph;
+    _entry.index = index;
+
+    record.lastUsed = m_frame;
+    m_atlas[record.atlas].lastUsed = m_frame;
+
+    return true;
+}
+
+uint32_t GlyphAtlas::addGlyph(const GlyphKey& _key, AtlasID _atlas, const Glyph& _glyph) {
+    uint32_t index;
+
+    if (m_freeGlyphs.empty()) {
+        index = m_glyphs.size();
+        m_glyphs.push_back({_key, _atlas, _glyph, m_frame});
+    } else {
+        index = m_freeGlyphs.back();
+        m_freeGlyphs.pop_back();
+        m_glyphs[index] = {_key, _atlas, _glyph, m_frame, m_glyphs[index].version};
+    }
+
+    m_atlas[_atlas].lastUsed = m_frame;
+
+    m_glyphIndex.insert(_key.packed(), index);
+
+    updateGlyphTable(index);
+
+    return index;
+}
+
+void GlyphAtlas::updateGlyphTable(uint32_t _index) {
+    if (_index >= m_glyphTable.size()) { m_glyphTable.resize(_index + 1); }
+
+    auto& record = m_glyphs[_index];
+    auto& g = record.glyph;
+    m_glyphTable[_index] = { g.offset.x, g.offset.y, g.size.x, g.size.y,
+                             g.u1, g.v1, g.u2, g.v2, uint32_t(record.atlas) };
+
+    if (m_tableChanges.begin == m_tableChanges.end) {
+        m_tableChanges = { _index, _index + 1 };
+    } else {
+        m_tableChanges.begin = std::min<size_t>(m_tableChanges.begin, _index);
+        m_tableChanges.end = std::max<size_t>(m_tableChanges.end, _index + 1);
+    }
+}
+
+auto GlyphAtlas::glyphTableChanges() -> TableRange {
+    auto changes = m_tableChanges;
+    m_tableChanges = { 0, 0 };
+    return changes;
+}
+
+bool GlyphAtlas::getGlyph(const Font& _font, const GlyphKey& _key, AtlasGlyph& _entry) {
+
+    if (findGlyph(_key, _entry)) { return true; }
+
+    return createGlyph(_font, _key, _entry);
+}
+
+bool GlyphAtlas::packGlyph(const GlyphKey& _key, int _x0, int _y0, int _w, int _h,
+                           int _channels, AtlasGlyph& _entry) {
 
     unsigned int pad = m_padding;
-    int w = gd->x1 - gd->x0;
-    int h = gd->y1 - gd->y0;
-    int texW = w + pad * 2;
-    int texH = h + pad * 2;
+    int texW = _w + pad * 2;
+    int texH = _h + pad * 2;
 
-    if (texW > m_textureSize || texH > m_textureSize) {
+    int maxSize = std::max(m_textureSize, m_maxTextureSize);
+    if (texW > maxSize || texH > maxSize) {
         return false;
     }
 
@@ -160,38 +398,629 @@ bool GlyphAtlas::createGlyph(const Font& _font, const GlyphKey& _key, AtlasGlyph
 
     AtlasID id = 0;
     for (auto& a : m_atlas) {
-        if (a.addRect(texW, texH, &x, &y)) {
+        if (a.channels == _channels && a.addRect(texW, texH, &x, &y)) {
             atlas = &a;
             break;
         }
         id++;
     }
+    // Grow atlases before adding another one
+    for (AtlasID i = 0; !atlas && i < m_atlas.size(); i++) {
+        if (m_atlas[i].channels != _channels) { continue; }
+
+        while (growAtlas(i)) {
+            if (m_atlas[i].addRect(texW, texH, &x, &y)) {
+                atlas = &m_atlas[i];
+                id = i;
+                break;
+            }
+        }
+    }
+    bool placed = atlas != nullptr;
+
+    if (!atlas && m_maxAtlases > 0 && m_atlas.size() >= m_maxAtlases) {
+        id = evictionCandidate();
+        if (id == m_atlas.size()) {
+            LOGE("All %d atlases are in use", m_atlas.size());
+            return false;
+        }
+        evictAtlas(id);
+
+        atlas = &m_atlas[id];
+        if (atlas->channels != _channels) {
+            // Reuse for another texture format
+            *atlas = Atlas(atlas->width, atlas->height, _channels);
+            addTexture(id);
+        }
+    }
     if (!atlas) {
-        m_atlas.emplace_back(m_textureSize, m_textureSize);
+        m_atlas.emplace_back(m_textureSize, m_textureSize, _channels);
         atlas = &m_atlas.back();
-        m_textureCb.addTexture(id, m_textureSize, m_textureSize);
+        addTexture(id);
+    }
+    // Glyph may be larger than a new atlas
+    while (!placed) {
+        placed = atlas->addRect(texW, texH, &x, &y);
+        if (!placed && !growAtlas(id)) { return false; }
+    }
+
+    _entry.atlas = id;
+    _entry.index = addGlyph(_key, id, Glyph(x, y, texW, texH,
+                                            glm::vec2(_x0, _y0) - float(pad),
+                                            glm::vec2(_w, _h) + float(pad * 2)));
+    _entry.glyph = &m_glyphs[_entry.index].glyph;
+
+    return true;
+}
+
+bool GlyphAtlas::createGlyph(const Font& _font, const GlyphKey& _key, AtlasGlyph& _entry) {
+
+    if (_key.codepoint == 0) { return false; }
+
+    if (_key.stroke && isDistanceField()) { return false; }
+
+    auto& fontFace = _font.face(_key.font);
+
+    if (sharesGlyphs()) {
+        auto& face = registerFace(fontFace);
+
+        // Glyph may have been added for another size
+        if (findGlyph(_key, _entry)) { return true; }
+
+        GlyphKey key = _key;
+        storageKey(key, _entry.scale);
+
+        if (adoptGlyph(face, key, _entry)) {
+            _entry.scale = face.scale;
+            return true;
+        }
+
+        std::vector<GlyphBitmap> bitmaps;
+        rasterizer().rasterize({GlyphRequest(face.source, _key.codepoint, face.size,
+                                             m_glyphFormat, m_sdfSpread,
+                                             key.strokeWidth())},
+                               bitmaps);
 
-        if (!atlas->addRect(texW, texH, &x, &y)) {
-            // TODO  glyph does not fit into atlas size - check beforehand
+        auto& bitmap = bitmaps.front();
+        if (!bitmap.isValid()) { return false; }
+
+        if (!packGlyph(key, bitmap.x0, bitmap.y0,
+                       bitmap.width(), bitmap.height(), bitmap.channels, _entry)) {
             return false;
         }
+
+        uploadGlyph(_entry, bitmap.width(), bitmap.height(), bitmap.buffer.data());
+
+        _entry.scale = face.scale;
+        return true;
     }
 
-    m_textureCb.addGlyph(id, x, y, w, h, gd->getBuffer(), pad);
+    auto& face = registerFace(fontFace);
 
-    auto glyphItem = atlas->glyphMap.emplace(_key, Glyph(x, y, w + pad * 2, h + pad * 2,
-                                                        glm::vec2(gd->x0, gd->y0) - float(pad),
-                                                        glm::vec2(w, h) + float(pad * 2)));
-    _entry.atlas = id;
-    _entry.glyph = &(glyphItem.first->second);
+    if (adoptGlyph(face, _key, _entry)) { return true; }
+
+    if (_key.stroke || fontFace.glyphFlags(_key.codepoint) & FontFace::GlyphFlag::color) {
+        GlyphBitmap bitmap;
+        if (!fontFace.createGlyph(_key.codepoint, bitmap, _key.strokeWidth())) {
+            return false;
+        }
+
+        if (!packGlyph(_key, bitmap.x0, bitmap.y0, bitmap.width(), bitmap.height(),
+                       bitmap.channels, _entry)) {
+            return false;
+        }
+        uploadGlyph(_entry, bitmap.width(), bitmap.height(), bitmap.buffer.data());
+        return true;
+    }
+
+    const auto* gd = fontFace.createGlyph(_key.codepoint);
+    if (!gd) { return false; }
+
+    int w = gd->x1 - gd->x0;
+    int h = gd->y1 - gd->y0;
+
+    if (!packGlyph(_key, gd->x0, gd->y0, w, h, 1, _entry)) { return false; }
+
+    uploadGlyph(_entry, w, h, gd->getTopRow(), gd->getPitch());
 
     return true;
 }
 
+bool GlyphAtlas::prepare(const LineLayout& _lineLayout, float _stroke) {
+    return prepare(std::vector<const LineLayout*>{ &_lineLayout }, _stroke);
+}
+
+bool GlyphAtlas::prepare(const std::vector<const LineLayout*>& _lineLayouts, float _stroke) {
+
+    // Collect glyphs not yet in the atlas
+    std::vector<GlyphRequest> requests;
+    std::vector<GlyphKey> keys;
+    std::unordered_set<GlyphKey> pending;
+
+    AtlasGlyph entry;
+
+    auto addRequest = [&](const FontFace& face, GlyphKey key) {
+        if (findGlyph(key, entry)) { return; }
+
+        if (sharesGlyphs()) {
+            auto& source = registerFace(face);
+            if (findGlyph(key, entry)) { return; }
+
+            storageKey(key, entry.scale);
+            if (!pending.insert(key).second) { return; }
+            if (adoptGlyph(source, key, entry)) { return; }
+
+            requests.emplace_back(source.source, key.codepoint, source.size,
+                                  m_glyphFormat, m_sdfSpread, key.strokeWidth());
+        } else {
+            if (!pending.insert(key).second) { return; }
+
+            auto& source = registerFace(face);
+            if (adoptGlyph(source, key, entry)) { return; }
+
+            requests.emplace_back(&face, key.codepoint, 0, GlyphFormat::coverage, 0,
+                                  key.strokeWidth());
+        }
+        keys.push_back(key);
+    };
+
+    uint8_t stroke = isDistanceField() ? 0 : GlyphKey::strokeUnits(_stroke);
+
+    for (auto* line : _lineLayouts) {
+        for (auto& shape : line->shapes()) {
+            if (shape.isSpace || shape.isEmpty || shape.codepoint == 0) { continue; }
+
+            auto& face = line->font().face(shape.face);
+            if (face.isEmpty(shape.codepoint)) { continue; }
+
+            addRequest(face, {shape.face, shape.codepoint});
+
+            if (stroke) { addRequest(face, {shape.face, shape.codepoint, stroke}); }
+        }
+    }
+
+    if (requests.empty()) { return true; }
+
+    std::vector<GlyphBitmap> bitmaps;
+
+    if (m_rasterizer || sharesGlyphs()) {
+        rasterizer().rasterize(requests, bitmaps);
+    } else {
+        bitmaps.resize(requests.size());
+        for (size_t i = 0; i < requests.size(); i++) {
+            requests[i].face->createGlyph(requests[i].codepoint, bitmaps[i],
+                                          requests[i].stroke);
+        }
+    }
+
+    // Pack tallest glyphs first for a flatter skyline
+    std::vector<size_t> order;
+    order.reserve(requests.size());
+
+    for (size_t i = 0; i < requests.size(); i++) {
+        if (bitmaps[i].isValid()) {
+            order.push_back(i);
+        } else if (bitmaps[i].empty && requests[i].stroke == 0) {
+            // Only when rendered - failures, e.g. of opening the face, may
+            // be transient
+            requests[i].face->setEmpty(requests[i].codepoint);
+        }
+    }
+
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (bitmaps[a].height() != bitmaps[b].height()) {
+            return bitmaps[a].height() > bitmaps[b].height();
+        }
+        return bitmaps[a].width() > bitmaps[b].width();
+    });
+
+    struct Upload {
+        AtlasID atlas;
+        const Glyph* glyph;
+        const GlyphBitmap* bitmap;
+    };
+    std::vector<Upload> uploads;
+    uploads.reserve(order.size());
+
+    bool complete = true;
+
+    for (size_t i : order) {
+        auto& bitmap = bitmaps[i];
+
+        if (!packGlyph(keys[i], bitmap.x0, bitmap.y0, bitmap.width(), bitmap.height(),
+                       bitmap.channels, entry)) {
+            complete = false;
+            continue;
+        }
+        uploads.push_back({entry.atlas, entry.glyph, &bitmap});
+    }
+
+    // Issue uploads grouped by atlas texture
+    std::stable_sort(uploads.begin(), uploads.end(),
+                     [](const Upload& a, const Upload& b) { return a.atlas < b.atlas; });
+
+    for (auto& upload : uploads) {
+        uploadGlyph({upload.atlas, const_cast<Glyph*>(upload.glyph)},
+                    upload.bitmap->width(), upload.bitmap->height(),
+                    upload.bitmap->buffer.data());
+    }
+
+    return complete;
+}
+
+void GlyphAtlas::uploadGlyph(const AtlasGlyph& _entry, int _w, int _h,
+                             const unsigned char* _src, int _stride) {
+
+    auto& atlas = m_atlas[_entry.atlas];
+    int x = _entry.glyph->u1 + m_padding;
+    int y = _entry.glyph->v1 + m_padding;
+
+    atlas.setPixels(x, y, _w, _h, _src, _stride);
+
+    if (m_batchedUploads) {
+        // Include the padding - it may still hold pixels of evicted glyphs
+        atlas.markDirty(_entry.glyph->u1, _entry.glyph->v1,
+                        _w + m_padding * 2, _h + m_padding * 2);
+        return;
+    }
+
+    if (_stride != 0 && _stride != _w * atlas.channels) {
+        // Pass the tightly packed copy from the atlas pixels
+        std::vector<unsigned char> packed(_w * _h * atlas.channels);
+        for (int i = 0; i < _h; i++) {
+            memcpy(&packed[i * _w * atlas.channels],
+                   &atlas.pixels[((y + i) * atlas.width + x) * atlas.channels],
+                   _w * atlas.channels);
+        }
+        m_textureCb.addGlyph(_entry.atlas, _entry.glyph->u1, _entry.glyph->v1, _w, _h,
+                             packed.data(), m_padding);
+        return;
+    }
+
+    m_textureCb.addGlyph(_entry.atlas, _entry.glyph->u1, _entry.glyph->v1, _w, _h,
+                         _src, m_padding);
+}
+
+void GlyphAtlas::update() {
+    for (AtlasID id = 0; id < m_atlas.size(); id++) {
+        auto& atlas = m_atlas[id];
+        if (!atlas.isDirty()) { continue; }
+
+        auto& d = atlas.dirty;
+        size_t stride = atlas.width * atlas.channels;
+
+        m_textureCb.updateTexture(id, d.x0, d.y0, d.x1 - d.x0, d.y1 - d.y0,
+                                  &atlas.pixels[d.y0 * stride + d.x0 * atlas.channels],
+                                  stride, textureFormat(id));
+        d = { 0, 0, 0, 0 };
+    }
+}
+
+AtlasID GlyphAtlas::evictionCandidate() const {
+    AtlasID candidate = m_atlas.size();
+
+    // Compare ages, frame numbers may wrap around
+    for (AtlasID id = 0; id < m_atlas.size(); id++) {
+        uint32_t age = m_frame - m_atlas[id].lastUsed;
+        if (age == 0) { continue; }
+
+        if (candidate == m_atlas.size() || age > m_frame - m_atlas[candidate].lastUsed) {
+            candidate = id;
+        }
+    }
+    return candidate;
+}
+
+void GlyphAtlas::evictAtlas(AtlasID _atlasId) {
+    if (m_evictionCb) {
+        std::vector<GlyphKey> keys;
+        for (auto& record : m_glyphs) {
+            if (record.atlas == _atlasId) { keys.push_back(record.key); }
+        }
+        m_evictionCb(_atlasId, keys);
+    }
+    clear(_atlasId);
+}
+
+size_t GlyphAtlas::evict(uint32_t _frames) {
+    size_t count = 0;
+
+    // Pages without glyphs are not evicted
+    std::vector<bool> used(m_atlas.size(), false);
+    for (auto& record : m_glyphs) {
+        if (record.atlas != GlyphIndex::npos) { used[record.atlas] = true; }
+    }
+    for (auto& item : m_restored) { used[item.second.first] = true; }
+
+    for (AtlasID id = 0; id < m_atlas.size(); id++) {
+        auto& atlas = m_atlas[id];
+        if (!used[id] || m_frame - atlas.lastUsed <= _frames) { continue; }
+
+        evictAtlas(id);
+        count++;
+    }
+    return count;
+}
+
+auto GlyphAtlas::compact(float _maxFill, uint32_t _maxAge) -> std::vector<GlyphMove> {
+
+    std::vector<GlyphMove> moves;
+
+    // Drop glyphs not used for @maxAge frames
+    for (uint32_t i = 0; i < m_glyphs.size(); i++) {
+        auto& record = m_glyphs[i];
+        if (record.atlas == GlyphIndex::npos) { continue; }
+        if (m_frame - record.lastUsed <= _maxAge) { continue; }
+
+        moves.push_back({record.key, record.atlas, GlyphIndex::npos, nullptr});
+
+        m_glyphIndex.erase(record.key.packed());
+        record.atlas = GlyphIndex::npos;
+        record.version++;
+        m_freeGlyphs.push_back(i);
+    }
+
+    if (!moves.empty()) { m_version++; }
+
+    // Select atlases filled less than @maxFill
+    std::vector<size_t> used(m_atlas.size(), 0);
+    for (auto& record : m_glyphs) {
+        if (record.atlas == GlyphIndex::npos) { continue; }
+        auto& g = record.glyph;
+        used[record.atlas] += (g.u2 - g.u1) * (g.v2 - g.v1);
+    }
+
+    // Keep atlases with restored glyphs that are not in m_glyphs yet
+    std::vector<bool> restored(m_atlas.size(), false);
+    for (auto& item : m_restored) { restored[item.second.first] = true; }
+
+    std::vector<bool> repack(m_atlas.size(), false);
+    size_t repackCount = 0;
+    bool hasEmpty = false;
+
+    for (AtlasID id = 0; id < m_atlas.size(); id++) {
+        auto& atlas = m_atlas[id];
+        if (restored[id] || used[id] >= _maxFill * atlas.width * atlas.height) { continue; }
+
+        repack[id] = true;
+        repackCount++;
+        if (used[id] == 0) { hasEmpty = true; }
+    }
+
+    // Repacking a single atlas only helps when it is empty
+    if (repackCount == 0 || (repackCount == 1 && !hasEmpty)) { return moves; }
+
+    // Copy out glyphs of selected atlases, including padding
+    struct Item {
+        uint32_t record;
+        AtlasID oldAtlas;
+        std::vector<unsigned char> pixels;
+        // New position
+        int x, y;
+    };
+    std::vector<Item> items;
+
+    for (uint32_t i = 0; i < m_glyphs.size(); i++) {
+        auto& record = m_glyphs[i];
+        if (record.atlas == GlyphIndex::npos || !repack[record.atlas]) { continue; }
+
+        auto& atlas = m_atlas[record.atlas];
+        auto& g = record.glyph;
+        int w = g.u2 - g.u1;
+        int h = g.v2 - g.v1;
+        size_t row = w * atlas.channels;
+
+        items.push_back({i, record.atlas, std::vector<unsigned char>(row * h), 0, 0});
+        for (int y = 0; y < h; y++) {
+            memcpy(&items.back().pixels[y * row],
+                   &atlas.pixels[((g.v1 + y) * atlas.width + g.u1) * atlas.channels], row);
+        }
+    }
+
+    std::sort(items.begin(), items.end(), [&](const Item& a, const Item& b) {
+        auto& ga = m_glyphs[a.record].glyph;
+        auto& gb = m_glyphs[b.record].glyph;
+        if (ga.v2 - ga.v1 != gb.v2 - gb.v1) { return ga.v2 - ga.v1 > gb.v2 - gb.v1; }
+        return ga.u2 - ga.u1 > gb.u2 - gb.u1;
+    });
+
+    // Repack into fresh atlases of the same format
+    std::vector<Atlas> packed;
+    std::vector<size_t> packedAtlas(items.size());
+
+    for (size_t i = 0; i < items.size(); i++) {
+        auto& g = m_glyphs[items[i].record].glyph;
+        int w = g.u2 - g.u1;
+        int h = g.v2 - g.v1;
+        int channels = m_atlas[items[i].oldAtlas].channels;
+        int x, y;
+
+        size_t p = 0;
+        size_t last = packed.size();
+        for (; p < packed.size(); p++) {
+            if (packed[p].channels != channels) { continue; }
+            if (packed[p].addRect(w, h, &x, &y)) { break; }
+            last = p;
+        }
+        if (p == packed.size() && last < packed.size()) {
+            // Grow the last one before adding another atlas
+            auto& atlas = packed[last];
+            while (atlas.width < m_maxTextureSize) {
+                int size = std::min(atlas.width * 2, m_maxTextureSize);
+                atlas.expand(size, size);
+                if (atlas.addRect(w, h, &x, &y)) {
+                    p = last;
+                    break;
+                }
+            }
+        }
+        if (p == packed.size()) {
+            packed.emplace_back(m_textureSize, m_textureSize, channels);
+            if (!packed.back().addRect(w, h, &x, &y)) {
+                int size = m_maxTextureSize;
+                packed.back().expand(size, size);
+                packed.back().addRect(w, h, &x, &y);
+            }
+        }
+        packed[p].setPixels(x, y, w, h, items[i].pixels.data());
+        packed[p].lastUsed = std::max(packed[p].lastUsed, m_glyphs[items[i].record].lastUsed);
+
+        items[i].x = x;
+        items[i].y = y;
+        packedAtlas[i] = p;
+    }
+
+    if (packed.size() >= repackCount) { return moves; }
+
+    m_version++;
+
+    for (auto& item : items) {
+        auto& g = m_glyphs[item.record].glyph;
+        g.u2 = item.x + (g.u2 - g.u1);
+        g.v2 = item.y + (g.v2 - g.v1);
+        g.u1 = item.x;
+        g.v1 = item.y;
+    }
+
+    // Put repacked atlases into the slots of the selected ones and
+    // close the gaps. Atlases that change content or id are uploaded again.
+    size_t textureCount = m_atlas.size();
+    std::vector<int> textureSize, textureChannels;
+    for (auto& atlas : m_atlas) {
+        textureSize.push_back(atlas.width);
+        textureChannels.push_back(atlas.channels);
+    }
+
+    std::vector<Atlas> atlases;
+    std::vector<AtlasID> newId(m_atlas.size(), GlyphIndex::npos);
+    std::vector<AtlasID> packedId(packed.size());
+    std::vector<bool> upload;
+
+    size_t next = 0;
+    for (AtlasID id = 0; id < m_atlas.size(); id++) {
+        if (!repack[id]) {
+            newId[id] = atlases.size();
+            upload.push_back(newId[id] != id);
+            atlases.push_back(std::move(m_atlas[id]));
+        } else if (next < packed.size()) {
+            packedId[next] = atlases.size();
+            upload.push_back(true);
+            atlases.push_back(std::move(packed[next++]));
+        }
+    }
+    for (; next < packed.size(); next++) {
+        packedId[next] = atlases.size();
+        upload.push_back(true);
+        atlases.push_back(std::move(packed[next]));
+    }
+    m_atlas = std::move(atlases);
+
+    for (uint32_t i = 0; i < m_glyphs.size(); i++) {
+        auto& record = m_glyphs[i];
+        if (record.atlas == GlyphIndex::npos || repack[record.atlas]) { continue; }
+        if (newId[record.atlas] == record.atlas) { continue; }
+
+        moves.push_back({record.key, record.atlas, newId[record.atlas], &record.glyph});
+        record.atlas = newId[record.atlas];
+        record.version++;
+        updateGlyphTable(i);
+    }
+    for (size_t i = 0; i < items.size(); i++) {
+        auto& record = m_glyphs[items[i].record];
+        record.atlas = packedId[packedAtlas[i]];
+        record.version++;
+        moves.push_back({record.key, items[i].oldAtlas, record.atlas, &record.glyph});
+        updateGlyphTable(items[i].record);
+    }
+
+    for (auto& item : m_restored) {
+        item.second.first = newId[item.second.first];
+    }
+
+    for (AtlasID id = 0; id < m_atlas.size(); id++) {
+        auto& atlas = m_atlas[id];
+        if (id >= textureCount) {
+            addTexture(id);
+        } else if (atlas.channels != textureChannels[id]) {
+            addTexture(id);
+        } else if (atlas.width != textureSize[id]) {
+            m_textureCb.resizeTexture(id, atlas.width, atlas.height, textureFormat(id));
+        }
+        if (upload[id]) { uploadAtlas(id); }
+    }
+    for (AtlasID id = textureCount; id > m_atlas.size(); id--) {
+        m_textureCb.removeTexture(id - 1);
+    }
+
+    return moves;
+}
+
+bool GlyphAtlas::growAtlas(AtlasID _atlasId) {
+    auto& atlas = m_atlas[_atlasId];
+    if (atlas.width >= m_maxTextureSize && atlas.height >= m_maxTextureSize) { return false; }
+
+    int w = std::min(atlas.width * 2, m_maxTextureSize);
+    int h = std::min(atlas.height * 2, m_maxTextureSize);
+    atlas.expand(std::max(w, atlas.width), std::max(h, atlas.height));
+
+    m_textureCb.resizeTexture(_atlasId, atlas.width, atlas.height, textureFormat(_atlasId));
+    uploadAtlas(_atlasId);
+
+    return true;
+}
+
+void GlyphAtlas::addTexture(AtlasID _atlasId) {
+    auto& atlas = m_atlas[_atlasId];
+
+    auto format = textureFormat(_atlasId);
+
+    if (format == TextureFormat::alpha) {
+        m_textureCb.addTexture(_atlasId, atlas.width, atlas.height);
+    } else {
+        m_textureCb.addTexture(_atlasId, atlas.width, atlas.height, format);
+    }
+}
+
+void GlyphAtlas::uploadAtlas(AtlasID _atlasId) {
+    auto& atlas = m_atlas[_atlasId];
+
+    if (m_batchedUploads) {
+        atlas.markDirty(0, 0, atlas.width, atlas.height);
+    } else {
+        m_textureCb.addGlyph(_atlasId, 0, 0, atlas.width, atlas.height, atlas.pixels.data(), 0);
+    }
+}
+
 void GlyphAtlas::clear(AtlasID _atlasId) {
     if (_atlasId >= m_atlas.size()) { return; }
 
-    m_atlas[_atlasId].reset(m_textureSize, m_textureSize);
+    for (auto it = m_restored.begin(); it != m_restored.end();) {
+        if (it->second.first == _atlasId) {
+            it = m_restored.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (uint32_t i = 0; i < m_glyphs.size(); i++) {
+        auto& record = m_glyphs[i];
+        if (record.atlas != _atlasId) { continue; }
+
+        m_glyphIndex.erase(record.key.packed());
+        record.atlas = GlyphIndex::npos;
+        record.version++;
+        m_freeGlyphs.push_back(i);
+    }
+    m_version++;
+
+    // Keep the size of the texture
+    auto& atlas = m_atlas[_atlasId];
+    atlas.reset(atlas.width, atlas.height);
+
+    // New glyphs are uploaded without their padding unless uploads are
+    // batched: Clear the texture so that the padding does not show
+    // pixels of evicted glyphs.
+    if (!m_batchedUploads) { uploadAtlas(_atlasId); }
 }
 
 
@@ -2,8 +2,16 @@
 
 #include "alfons.h"
 #include "glyph.h"
+#include "glyphIndex.h"
+#include "glyphRasterizer.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <deque>
+#include <functional>
 #include <vector>
 #include <memory>
+#include <string>
 
 #include <unordered_map>
 
@@ -12,12 +20,28 @@ namespace alfons {
 struct GlyphKey {
     uint32_t font;
     uint32_t codepoint;
+    // Halo width of stroked glyphs in 1/4 pixels, 0 for regular glyphs
+    uint8_t stroke;
 
-    GlyphKey(uint32_t font, uint32_t codepoint)
-        : font(font), codepoint(codepoint) {}
+    GlyphKey(uint32_t font, uint32_t codepoint, uint8_t stroke = 0)
+        : font(font), codepoint(codepoint), stroke(stroke) {}
 
     bool operator==(const GlyphKey& other) const {
-        return (font == other.font && codepoint == other.codepoint);
+        return (font == other.font && codepoint == other.codepoint &&
+                stroke == other.stroke);
+    }
+
+    // Glyph ids are 16 bit, the stroke goes into the unused high bits
+    uint64_t packed() const {
+        return uint64_t(font) << 32 | uint32_t(stroke) << 24 | codepoint;
+    }
+
+    float strokeWidth() const { return stroke * 0.25f; }
+
+    // Stroke for a halo of @width pixels, at least 1 for any @width > 0
+    static uint8_t strokeUnits(float width) {
+        if (width <= 0) { return 0; }
+        return uint8_t(std::min(std::max(std::lround(width * 4), 1L), 255L));
     }
 };
 }
@@ -26,8 +50,7 @@ namespace std {
 template <>
 struct hash<alfons::GlyphKey> {
     std::size_t operator()(const alfons::GlyphKey& k) const {
-        return ((std::hash<uint32_t>()(k.font) ^
-                 std::hash<uint32_t>()(k.codepoint) << 1)) >> 1;
+        return alfons::GlyphIndex::hash(k.packed());
     }
 };
 }
@@ -40,7 +63,7 @@ class Atlas {
     };
 
 public:
-    Atlas(int w, int h);
+    Atlas(int w, int h, int channels = 1);
 
     bool addRect(int rw, int rh, int* rx, int* ry);
 
@@ -50,12 +73,32 @@ public:
 
     void addSkylineLevel(uint32_t idx, int x, int y, int w, int h);
 
-    int rectFits(uint32_t i, int w, int h);
+    int rectFits(uint32_t i, int w, int h, int maxY = INT_MAX) const;
+
+    // Copy @w x @h pixels from @src into pixels at @x, @y. Rows of @src are
+    // @stride bytes apart, tightly packed when 0.
+    void setPixels(int x, int y, int w, int h, const unsigned char* src, int stride = 0);
+
+    // Extend the dirty region by @w x @h at @x, @y
+    void markDirty(int x, int y, int w, int h);
+
+    bool isDirty() const { return dirty.x1 > dirty.x0; }
 
     int width, height;
     std::vector<Node> nodes;
 
-    std::unordered_map<GlyphKey, Glyph> glyphMap;
+    // Lowest skyline segment
+    int lowest = 0;
+
+    // CPU copy of the texture content
+    int channels;
+    std::vector<unsigned char> pixels;
+
+    // Bounds of pixels not yet passed to TextureCallback::updateTexture()
+    struct { int x0, y0, x1, y1; } dirty = { 0, 0, 0, 0 };
+
+    // Last frame in which a glyph of this atlas was used
+    uint32_t lastUsed = 0;
 };
 
 using AtlasID = size_t;
@@ -63,29 +106,335 @@ using AtlasID = size_t;
 struct AtlasGlyph {
     AtlasID atlas;
     Glyph* glyph;
+    // Scale from glyph offset and size to font pixels. Not 1 only for
+    // glyphs rendered at a different size (distance fields, size buckets).
+    float scale = 1;
+    // Entry in GlyphAtlas::glyphTable()
+    uint32_t index = 0;
+};
+
+// Glyph data for drawing glyph instances, see GlyphAtlas::glyphTable().
+// Tightly packed, 28 bytes.
+struct GlyphTableEntry {
+    // Glyph::offset and Glyph::size
+    float x, y, w, h;
+    // Texel rectangle in the atlas page, including padding
+    uint16_t u1, v1, u2, v2;
+    uint32_t atlas;
 };
 
 class LineLayout;
 class Font;
+class FontFace;
 
-class GlyphAtlas {
+// Faces are observed (see FaceObserver): When a face is destroyed its
+// glyphs are removed, or shared glyphs are handed to another face of the
+// same font. Faces must not be destroyed while the atlas is used on
+// another thread.
+class GlyphAtlas : public FaceObserver {
 
 public:
-    GlyphAtlas(TextureCallback& _textureCb, uint16_t _textureSize = 512, int _glyphPadding = 1)
-        : m_textureSize(_textureSize),
-          m_padding(_glyphPadding),
-          m_textureCb(_textureCb) {}
+    GlyphAtlas(TextureCallback& _textureCb, uint16_t _textureSize = 512, int _glyphPadding = 1);
+
+    ~GlyphAtlas();
+
+    void faceUnloaded(const FontFace& face, bool destroyed) override;
+
+    // Add all glyphs of @lineLayout that are not yet in the atlas: Missing
+    // glyphs are rendered first (on the rasterizer threads when one is set),
+    // then packed by decreasing height and uploaded grouped by atlas.
+    // Returns false when some glyphs could not be added.
+    // With @stroke > 0 the halo glyphs of that width are added as well.
+    bool prepare(const LineLayout& lineLayout, float stroke = 0);
+    bool prepare(const std::vector<const LineLayout*>& lineLayouts, float stroke = 0);
 
-    bool prepare(LineLayout& lineLayout);
+    // Glyphs with GlyphKey::stroke are halo glyphs: the outline grown by
+    // the stroke width, as coverage. Not available for distance fields,
+    // where halos are drawn from the distance, nor for glyphs without
+    // outline.
     bool getGlyph(const Font& font, const GlyphKey& key, AtlasGlyph& entry);
 
+    // Lookup only, does not create missing glyphs
+    bool findGlyph(const GlyphKey& key, AtlasGlyph& entry);
+
     bool createGlyph(const Font& font, const GlyphKey& key, AtlasGlyph& entry);
 
+    // Use @rasterizer for rendering glyphs in prepare(), may be null.
+    void setRasterizer(GlyphRasterizer* rasterizer) { m_rasterizer = rasterizer; }
+
+    // Store glyphs as signed distance fields (see distanceField()). Glyphs
+    // are rendered once at @referenceSize and shared by all sizes of a font;
+    // @spread is the distance range in pixels at the reference size, at
+    // least 1.
+    // With @multiChannel glyphs are rendered from their outlines into RGB
+    // textures (see multiChannelDistanceField()).
+    // Must be set before any glyph is added.
+    void setDistanceField(float referenceSize, int spread, bool multiChannel = false);
+
+    bool isDistanceField() const { return m_sdfSize > 0; }
+
+    // Render glyphs at sizes rounded up to a multiple of @step instead of
+    // the exact face size. Faces of one font that fall into the same bucket
+    // share their glyphs, quads are scaled down to the requested size.
+    // 0 disables bucketing, ignored for distance fields.
+    // Must be set before any glyph is added.
+    void setSizeBuckets(float step) { m_sizeStep = step; }
+
+    // Texture format of regular glyphs. Color glyphs (see FontFace::GlyphFlag)
+    // are stored in separate TextureFormat::bgra atlases.
+    TextureFormat textureFormat() const {
+        return m_glyphFormat == GlyphFormat::msdf ? TextureFormat::rgb : TextureFormat::alpha;
+    }
+
+    TextureFormat textureFormat(AtlasID atlasId) const {
+        switch (m_atlas[atlasId].channels) {
+        case 3: return TextureFormat::rgb;
+        case 4: return TextureFormat::bgra;
+        default: return TextureFormat::alpha;
+        }
+    }
+
+    // Remove all glyphs of @atlasId. Without batched uploads the cleared
+    // page is uploaded at once.
     void clear(AtlasID atlasId);
+
+    // Quad and texel rectangles of all glyphs, indexed by AtlasGlyph::index,
+    // to upload as a GPU buffer for GlyphInstance drawing. Entries of
+    // removed glyphs are not cleared - they may be reused by new glyphs.
+    const std::vector<GlyphTableEntry>& glyphTable() const { return m_glyphTable; }
+
+    struct TableRange { size_t begin, end; };
+
+    // Range of glyphTable() entries modified since the last call, for
+    // partial uploads. begin == end when nothing changed.
+    TableRange glyphTableChanges();
+
+    // Incremented whenever glyphs are removed or moved, by eviction,
+    // clear(), compact() or when their face is destroyed
+    uint32_t version() const { return m_version; }
+
+    // Changes when glyph @index (AtlasGlyph::index) is removed or moved:
+    // AtlasGlyph data of the glyph is valid as long as this stays the same
+    uint32_t glyphVersion(uint32_t index) const { return m_glyphs[index].version; }
+
+    // Mark glyph @index as used in the current frame, for glyphs that are
+    // drawn without lookup (see TextMesh)
+    void markUsed(uint32_t index) {
+        auto& record = m_glyphs[index];
+        record.lastUsed = m_frame;
+        m_atlas[record.atlas].lastUsed = m_frame;
+    }
+
+    // Called before the glyphs of an atlas are evicted. Glyphs in @keys and
+    // their AtlasGlyph handles are invalid afterwards - meshes using them
+    // must be rebuilt.
+    using EvictionCallback = std::function<void(AtlasID atlas, const std::vector<GlyphKey>& keys)>;
+
+    void setEvictionCallback(EvictionCallback callback) { m_evictionCb = std::move(callback); }
+
+    // Start a new frame: Glyphs looked up from here on are marked as used
+    // in the new frame. Atlases with glyphs used in the current frame are
+    // never evicted.
+    void advanceFrame() { m_frame++; }
+
+    uint32_t frame() const { return m_frame; }
+
+    // Let full atlases grow by doubling their size up to @size before a new
+    // one is added. Glyphs keep their pixel position, the texture is
+    // resized by TextureCallback::resizeTexture() and uploaded again.
+    void setMaxTextureSize(uint16_t size) { m_maxTextureSize = size; }
+
+    // Limit the number of atlas textures: When all are full, the least
+    // recently used atlas is cleared and reused for new glyphs.
+    // 0 (default) for no limit.
+    void setMaxAtlases(size_t count) { m_maxAtlases = count; }
+
+    // Clear all atlases that were not used in the last @frames frames.
+    // Returns the number of evicted atlases.
+    size_t evict(uint32_t frames);
+
+    struct GlyphMove {
+        GlyphKey key;
+        AtlasID oldAtlas;
+        // GlyphIndex::npos when the glyph was dropped
+        AtlasID newAtlas;
+        // New placement, null when dropped
+        const Glyph* glyph;
+    };
+
+    // Drop glyphs not used in the last @maxAge frames and repack the glyphs
+    // of all atlases filled less than @maxFill into as few atlases as
+    // possible, tallest first. Atlases are re-uploaded from their CPU copy,
+    // atlases that are no longer needed are passed to
+    // TextureCallback::removeTexture(). Returns the glyphs that were moved
+    // or dropped - their previous AtlasGlyph data is invalid.
+    std::vector<GlyphMove> compact(float maxFill = 1, uint32_t maxAge = UINT32_MAX);
+
+    // Defer texture uploads to update(): Glyphs are only copied into the
+    // atlas pages and update() passes the modified region of each page to
+    // TextureCallback::updateTexture() - one call per page instead of one
+    // addGlyph() per glyph.
+    void setBatchedUploads(bool batched) { m_batchedUploads = batched; }
+
+    // Upload modified regions, see setBatchedUploads()
+    void update();
+
+    // Serialize pages, skyline nodes and glyphs. Glyphs are stored by font
+    // data hash, face index and size so that they can be matched to faces
+    // of another process. Fields are fixed size and 8-byte aligned, data
+    // may be memory-mapped for restore().
+    std::vector<char> snapshot() const;
+
+    // Restore an atlas from snapshot() data - only works on an empty atlas
+    // with the same settings. Pages are passed to TextureCallback as one
+    // upload each; restored glyphs are assigned to faces on first use.
+    bool restore(const char* data, size_t size);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
 private:
+    // Find space for a glyph with bitmap size @w x @h and bitmap offset @x0, @y0
+    // in an atlas with @channels bytes per pixel and add it to the glyph map.
+    // Creates a new atlas when all are full.
+    bool packGlyph(const GlyphKey& key, int x0, int y0, int w, int h, int channels,
+                   AtlasGlyph& entry);
+
+    struct FaceEntry {
+        // The registered face, null when not registered
+        const FontFace* face = nullptr;
+        // Face used to render glyphs, null when not registered
+        const FontFace* source = nullptr;
+        // GlyphKey::font under which the glyphs of a face are stored
+        uint32_t glyphFont = 0;
+        float scale = 1;
+        // Size at which glyphs are rendered
+        float size = 0;
+    };
+
+    // Whether glyphs are rendered at other than the face size and shared
+    // between faces (see m_sources)
+    bool sharesGlyphs() const { return isDistanceField() || m_sizeStep > 0; }
+
+    float renderSize(float faceSize) const;
+
+    // Map FaceID of @key to the shared source face and the stroke to the
+    // render size. Returns false when the face was not registered yet.
+    bool storageKey(GlyphKey& key, float& scale) const;
+
+    const FaceEntry& registerFace(const FontFace& face);
+
+    // Remove all glyphs stored under GlyphKey::font @glyphFont. Their
+    // pixels stay until the page is cleared or compacted.
+    void removeGlyphs(uint32_t glyphFont);
+
+    GlyphRasterizer& rasterizer();
+
+    // Copy glyph to the atlas pixels and pass it to TextureCallback, or
+    // mark it dirty when uploads are batched. @stride as for Atlas::setPixels
+    void uploadGlyph(const AtlasGlyph& entry, int w, int h, const unsigned char* src,
+                     int stride = 0);
+
+    struct SnapshotKey {
+        uint64_t fontHash;
+        uint32_t faceIndex;
+        float size;
+        uint32_t codepoint;
+
+        bool operator==(const SnapshotKey& o) const {
+            return fontHash == o.fontHash && faceIndex == o.faceIndex &&
+                size == o.size && codepoint == o.codepoint;
+        }
+    };
+    struct SnapshotKeyHash {
+        size_t operator()(const SnapshotKey& k) const {
+            return k.fontHash ^ (size_t(k.faceIndex) << 48) ^
+                (std::hash<float>()(k.size) << 24) ^ k.codepoint;
+        }
+    };
+
+    SnapshotKey snapshotKey(const FaceEntry& face, const GlyphKey& key) const;
+
+    // Double the size of @atlasId, up to m_maxTextureSize. Returns false
+    // when it is already at the maximum.
+    bool growAtlas(AtlasID atlasId);
+
+    // Create the texture for @atlasId
+    void addTexture(AtlasID atlasId);
+
+    // Upload the whole @atlasId, or mark it dirty when batched
+    void uploadAtlas(AtlasID atlasId);
+
+    // Least recently used atlas that is not used in the current frame,
+    // or m_atlas.size() when there is none
+    AtlasID evictionCandidate() const;
+
+    // Notify m_evictionCb and clear @atlasId
+    void evictAtlas(AtlasID atlasId);
+
+    // Add a glyph record for @key and return its index in m_glyphs
+    uint32_t addGlyph(const GlyphKey& key, AtlasID atlas, const Glyph& glyph);
+
+    // Copy glyph record @index to m_glyphTable
+    void updateGlyphTable(uint32_t index);
+
+    // Move a restored glyph for @face into the glyph index under @key
+    bool adoptGlyph(const FaceEntry& face, const GlyphKey& key, AtlasGlyph& entry);
+
+    // Glyphs from restore() not yet used by a face
+    std::unordered_map<SnapshotKey, std::pair<AtlasID, Glyph>, SnapshotKeyHash> m_restored;
+
     std::vector<Atlas> m_atlas;
 
+    struct GlyphSlot {
+        GlyphKey key;
+        // npos when the record is unused
+        AtlasID atlas;
+        Glyph glyph;
+        // Frame of last lookup
+        uint32_t lastUsed;
+        // See glyphVersion()
+        uint32_t version = 0;
+    };
+
+    // Glyphs of all pages. A deque so that AtlasGlyph::glyph stays valid,
+    // records of cleared pages are reused through m_freeGlyphs.
+    std::deque<GlyphSlot> m_glyphs;
+    std::vector<uint32_t> m_freeGlyphs;
+
+    // GlyphKey::packed() -> index in m_glyphs
+    GlyphIndex m_glyphIndex;
+
+    // Indexed like m_glyphs
+    std::vector<GlyphTableEntry> m_glyphTable;
+    TableRange m_tableChanges = { 0, 0 };
+
+    GlyphRasterizer* m_rasterizer = nullptr;
+    // Renders on the calling thread when no rasterizer is set
+    std::unique_ptr<GlyphRasterizer> m_localRasterizer;
+
+    float m_sdfSize = 0;
+    int m_sdfSpread = 0;
+    GlyphFormat m_glyphFormat = GlyphFormat::coverage;
+
+    float m_sizeStep = 0;
+
+    bool m_batchedUploads = false;
+
+    uint32_t m_frame = 0;
+    uint32_t m_version = 0;
+    size_t m_maxAtlases = 0;
+    EvictionCallback m_evictionCb;
+
+    // Indexed by FaceID
+    std::vector<FaceEntry> m_faces;
+    // Shared glyph sources by font data and render size, indexed by
+    // GlyphKey::font when sharesGlyphs()
+    std::vector<FaceEntry> m_sources;
+
+    // Initial and maximum atlas size
     int m_textureSize;
+    int m_maxTextureSize;
     int m_padding;
 
     TextureCallback& m_textureCb;
@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// GlyphAtlas snapshot serialization
+
+#include "atlas.h"
+#include "fontFace.h"
+
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace alfons {
+
+namespace {
+
+const uint32_t SNAPSHOT_MAGIC = 0x41464c41; // 'ALFA'
+const uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pageCount;
+    uint32_t glyphCount;
+    float sdfSize;
+    int32_t sdfSpread;
+    int32_t padding;
+    uint32_t glyphFormat;
+};
+
+struct PageHeader {
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t nodeCount;
+};
+
+struct NodeRecord {
+    int32_t x, y, width;
+    int32_t unused;
+};
+
+struct GlyphRecord {
+    uint64_t fontHash;
+    uint32_t faceIndex;
+    float size;
+    uint32_t codepoint;
+    uint32_t page;
+    uint16_t u1, v1, u2, v2;
+    float offsetX, offsetY;
+    float sizeX, sizeY;
+};
+
+size_t align(size_t size) { return (size + 7) & ~size_t(7); }
+
+template<typename T>
+void write(std::vector<char>& out, const T& value) {
+    size_t pos = out.size();
+    out.resize(align(pos + sizeof(T)));
+    memcpy(&out[pos], &value, sizeof(T));
+}
+
+struct Reader {
+    const char* data;
+    size_t size;
+    size_t pos = 0;
+
+    size_t remaining() const { return pos < size ? size - pos : 0; }
+
+    const char* read(size_t bytes) {
+        if (pos + bytes > size) { return nullptr; }
+        const char* p = data + pos;
+        pos = align(pos + bytes);
+        return p;
+    }
+
+    template<typename T>
+    bool read(T& value) {
+        const char* p = read(sizeof(T));
+        if (!p) { return false; }
+        memcpy(&value, p, sizeof(T));
+        return true;
+    }
+};
+
+}
+
+auto GlyphAtlas::snapshotKey(const FaceEntry& _face, const GlyphKey& _key) const -> SnapshotKey {
+    // Codepoint with the stroke of halo glyphs in the high bits
+    return { _face.source->sourceHash(), uint32_t(_face.source->faceIndex()),
+             _face.size, uint32_t(_key.packed()) };
+}
+
+bool GlyphAtlas::adoptGlyph(const FaceEntry& _face, const GlyphKey& _key, AtlasGlyph& _entry) {
+    if (m_restored.empty()) { return false; }
+
+    auto it = m_restored.find(snapshotKey(_face, _key));
+    if (it == m_restored.end()) { return false; }
+
+    AtlasID id = it->second.first;
+    _entry.atlas = id;
+    _entry.index = addGlyph(_key, id, it->second.second);
+    _entry.glyph = &m_glyphs[_entry.index].glyph;
+
+    m_restored.erase(it);
+
+    return true;
+}
+
+std::vector<char> GlyphAtlas::snapshot() const {
+
+    std::vector<GlyphRecord> glyphs;
+
+    auto addRecord = [&](const SnapshotKey& key, AtlasID page, const Glyph& glyph) {
+        glyphs.push_back({ key.fontHash, key.faceIndex, key.size, key.codepoint,
+                           uint32_t(page), glyph.u1, glyph.v1, glyph.u2, glyph.v2,
+                           glyph.offset.x, glyph.offset.y, glyph.size.x, glyph.size.y });
+    };
+
+    auto& faces = sharesGlyphs() ? m_sources : m_faces;
+
+    for (auto& record : m_glyphs) {
+        auto& key = record.key;
+        if (record.atlas == GlyphIndex::npos) { continue; }
+        if (key.font >= faces.size() || !faces[key.font].source) { continue; }
+
+        addRecord(snapshotKey(faces[key.font], key), record.atlas, record.glyph);
+    }
+    for (auto& item : m_restored) {
+        addRecord(item.first, item.second.first, item.second.second);
+    }
+
+    std::vector<char> out;
+
+    SnapshotHeader header = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION,
+                              uint32_t(m_atlas.size()), uint32_t(glyphs.size()),
+                              m_sdfSize, m_sdfSpread, m_padding, uint32_t(m_glyphFormat) };
+    write(out, header);
+
+    for (auto& atlas : m_atlas) {
+        PageHeader page = { uint32_t(atlas.width), uint32_t(atlas.height),
+                            uint32_t(atlas.channels), uint32_t(atlas.nodes.size()) };
+        write(out, page);
+
+        for (auto& node : atlas.nodes) {
+            write(out, NodeRecord{ node.x, node.y, node.width, 0 });
+        }
+
+        size_t pos = out.size();
+        out.resize(align(pos + atlas.pixels.size()));
+        memcpy(&out[pos], atlas.pixels.data(), atlas.pixels.size());
+    }
+
+    for (auto& glyph : glyphs) { write(out, glyph); }
+
+    return out;
+}
+
+bool GlyphAtlas::restore(const char* _data, size_t _size) {
+
+    if (!m_atlas.empty()) {
+        LOGE("Cannot restore snapshot into non-empty atlas");
+        return false;
+    }
+
+    Reader reader{_data, _size};
+
+    SnapshotHeader header;
+    if (!reader.read(header) ||
+        header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION) {
+        LOGE("Invalid atlas snapshot");
+        return false;
+    }
+
+    if (header.sdfSize != m_sdfSize || header.sdfSpread != m_sdfSpread ||
+        header.padding != m_padding || header.glyphFormat != uint32_t(m_glyphFormat)) {
+        LOGE("Atlas snapshot does not match atlas settings");
+        return false;
+    }
+
+    uint32_t maxSize = uint32_t(std::max(m_textureSize, m_maxTextureSize));
+    std::vector<Atlas> pages;
+
+    for (uint32_t i = 0; i < header.pageCount; i++) {
+        PageHeader page;
+        if (!reader.read(page)) { return false; }
+
+        // Check sizes before allocating: The snapshot may be truncated or
+        // come from a device with larger textures
+        size_t bytes = size_t(page.width) * page.height * page.channels;
+        if (page.width == 0 || page.height == 0 ||
+            page.width > maxSize || page.height > maxSize ||
+            (page.channels != 1 && page.channels != 3 && page.channels != 4) ||
+            page.nodeCount == 0 || page.nodeCount > page.width ||
+            reader.remaining() < page.nodeCount * sizeof(NodeRecord) + bytes) {
+            LOGE("Invalid atlas snapshot page");
+            return false;
+        }
+
+        pages.emplace_back(page.width, page.height, page.channels);
+        auto& atlas = pages.back();
+
+        // Skyline nodes must cover the page width left to right without gaps
+        atlas.nodes.clear();
+        int64_t right = 0;
+        for (uint32_t n = 0; n < page.nodeCount; n++) {
+            NodeRecord node;
+            if (!reader.read(node)) { return false; }
+
+            if (node.x != right || node.width <= 0 || node.y < 0 ||
+                int64_t(node.x) + node.width > page.width || uint32_t(node.y) > page.height) {
+                LOGE("Invalid atlas snapshot page");
+                return false;
+            }
+            right = int64_t(node.x) + node.width;
+            atlas.nodes.push_back({ node.x, node.y, node.width });
+            atlas.lowest = n == 0 ? node.y : std::min(atlas.lowest, node.y);
+        }
+        if (right != page.width) {
+            LOGE("Invalid atlas snapshot page");
+            return false;
+        }
+
+        const char* pixels = reader.read(atlas.pixels.size());
+        if (!pixels) { return false; }
+        memcpy(atlas.pixels.data(), pixels, atlas.pixels.size());
+    }
+
+    decltype(m_restored) restored;
+
+    for (uint32_t i = 0; i < header.glyphCount; i++) {
+        GlyphRecord g;
+        if (!reader.read(g) || g.page >= pages.size()) { return false; }
+
+        auto& atlas = pages[g.page];
+        if (g.u2 < g.u1 || g.v2 < g.v1 || g.u2 > atlas.width || g.v2 > atlas.height ||
+            !std::isfinite(g.offsetX) || !std::isfinite(g.offsetY) ||
+            !std::isfinite(g.sizeX) || !std::isfinite(g.sizeY)) {
+            LOGE("Invalid atlas snapshot glyph");
+            return false;
+        }
+
+        Glyph glyph(g.u1, g.v1, g.u2 - g.u1, g.v2 - g.v1,
+                    glm::vec2(g.offsetX, g.offsetY), glm::vec2(g.sizeX, g.sizeY));
+
+        restored.emplace(SnapshotKey{ g.fontHash, g.faceIndex, g.size, g.codepoint },
+                         std::make_pair(AtlasID(g.page), glyph));
+    }
+
+    m_atlas = std::move(pages);
+    m_restored = std::move(restored);
+
+    // Upload each page at once
+    for (AtlasID id = 0; id < m_atlas.size(); id++) {
+        addTexture(id);
+        uploadAtlas(id);
+    }
+
+    return true;
+}
+
+bool GlyphAtlas::save(const std::string& _path) const {
+    auto data = snapshot();
+
+    std::ofstream file(_path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+
+    return bool(file);
+}
+
+bool GlyphAtlas::load(const std::string& _path) {
+    std::ifstream file(_path, std::ios::binary | std::ios::ate);
+    if (!file) { return false; }
+
+    std::vector<char> data(size_t(file.tellg()));
+    file.seekg(0);
+    if (!file.read(data.data(), data.size())) { return false; }
+
+    return restore(data.data(), data.size());
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace alfons {
+
+// Insert-only hash table with lock-free lookups.
+// Linear probing over an array of pointers to immutable entries, load
+// factor at most 1/2. find() may run on any thread while insert() is
+// called, inserts must be serialized by the caller.
+// Growing publishes a new array that points to the same entries. Replaced
+// arrays are only freed with the table, as readers may still probe them;
+// together they are smaller than the current one.
+template <class Key, class Value, class Hash = std::hash<Key>>
+class ConcurrentTable {
+
+public:
+    ConcurrentTable() { m_slots.store(grow(16), std::memory_order_release); }
+
+    ConcurrentTable(const ConcurrentTable&) = delete;
+    ConcurrentTable& operator=(const ConcurrentTable&) = delete;
+
+    // Returns nullptr when @key is not found
+    const Value* find(const Key& key) const {
+        const Slots* slots = m_slots.load(std::memory_order_acquire);
+
+        for (size_t i = Hash()(key) & slots->mask;; i = (i + 1) & slots->mask) {
+            const Entry* entry = slots->entries[i].load(std::memory_order_acquire);
+            if (!entry) { return nullptr; }
+            if (entry->key == key) { return &entry->value; }
+        }
+    }
+
+    // Add @value for @key unless the key exists. Returns the value
+    // stored for @key.
+    const Value& insert(const Key& key, Value value) {
+        Slots* slots = m_slots.load(std::memory_order_relaxed);
+
+        if (auto found = find(key)) { return *found; }
+
+        if ((m_entries.size() + 1) * 2 > slots->mask + 1) {
+            slots = grow((slots->mask + 1) * 2);
+            m_slots.store(slots, std::memory_order_release);
+        }
+
+        m_entries.emplace_back(new Entry{ key, std::move(value) });
+        const Entry* entry = m_entries.back().get();
+        place(*slots, entry, std::memory_order_release);
+
+        return entry->value;
+    }
+
+    // Number of entries. Only meaningful for the inserting thread.
+    size_t size() const { return m_entries.size(); }
+
+    // Call @f with key and value of each entry, in insertion order.
+    // Only for the inserting thread.
+    template <class F>
+    void forEach(F f) const {
+        for (auto& entry : m_entries) { f(entry->key, entry->value); }
+    }
+
+private:
+    struct Entry {
+        const Key key;
+        const Value value;
+    };
+
+    struct Slots {
+        size_t mask;
+        std::unique_ptr<std::atomic<const Entry*>[]> entries;
+    };
+
+    static void place(Slots& slots, const Entry* entry, std::memory_order order) {
+        size_t i = Hash()(entry->key) & slots.mask;
+        while (slots.entries[i].load(std::memory_order_relaxed)) {
+            i = (i + 1) & slots.mask;
+        }
+        slots.entries[i].store(entry, order);
+    }
+
+    // Returns a new array of @size slots holding all entries. The caller
+    // publishes it.
+    Slots* grow(size_t size) {
+        m_tables.emplace_back(new Slots{ size - 1, std::unique_ptr<std::atomic<const Entry*>[]>(
+                                                       new std::atomic<const Entry*>[size]) });
+        Slots* slots = m_tables.back().get();
+
+        for (size_t i = 0; i < size; i++) {
+            slots->entries[i].store(nullptr, std::memory_order_relaxed);
+        }
+        for (auto& entry : m_entries) {
+            place(*slots, entry.get(), std::memory_order_relaxed);
+        }
+        return slots;
+    }
+
+    std::atomic<Slots*> m_slots;
+
+    // Owned by the writer
+    std::vector<std::unique_ptr<Slots>> m_tables;
+    std::vector<std::unique_ptr<Entry>> m_entries;
+};
+
+}
@@ -15,6 +15,15 @@
 
 #include <hb-ft.h>
 
+#include <algorithm>
+#include <fstream>
+#include <functional>
+
+#include FT_TRUETYPE_TAGS_H
+#ifdef FT_COLOR_H
+#include FT_COLOR_H
+#endif
+
 
 
 static const FT_ULong SPACE_SEPARATORS[] = {
@@ -57,14 +66,31 @@ FontFace::FontFace(FreetypeHelper& _ft, FaceID _faceId,
 }
 
 FontFace::~FontFace() {
+    notifyObservers(true);
     unload();
 }
 
-bool FontFace::isSpace(hb_codepoint_t codepoint) const {
-    for (auto cp : m_spaceSeparators) {
-        if (cp == codepoint) { return true; }
+void FontFace::addObserver(FaceObserver* _observer) const {
+    std::lock_guard<std::mutex> lock(m_observersMutex);
+
+    if (std::find(m_observers.begin(), m_observers.end(), _observer) == m_observers.end()) {
+        m_observers.push_back(_observer);
     }
-    return false;
+}
+
+void FontFace::removeObserver(FaceObserver* _observer) const {
+    std::lock_guard<std::mutex> lock(m_observersMutex);
+
+    m_observers.erase(std::remove(m_observers.begin(), m_observers.end(), _observer),
+                      m_observers.end());
+}
+
+void FontFace::notifyObservers(bool _destroyed) {
+    std::lock_guard<std::mutex> lock(m_observersMutex);
+
+    for (auto* observer : m_observers) { observer->faceUnloaded(*this, _destroyed); }
+
+    if (_destroyed) { m_observers.clear(); }
 }
 
 hb_codepoint_t
@@ -76,6 +102,65 @@ FontFace::getCodepoint(FT_ULong charCode) const {
     }
 }
 
+uint64_t FontFace::sourceHash() const {
+    if (m_sourceHash) { return m_sourceHash; }
+
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto update = [&](const char* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ uint8_t(data[i])) * 0x100000001b3ULL;
+        }
+    };
+
+    // Digest of the length, the first block - holding the sfnt table
+    // directory with the checksum of each table (incl. 'head') - and
+    // blocks sampled over the rest of the data. Does not read whole
+    // font files.
+    const size_t headBlock = 64 * 1024;
+    const size_t sampleBlock = 4 * 1024;
+    const size_t samples = 16;
+
+    auto digest = [&](size_t length, std::function<void(size_t, size_t)> read) {
+        update(reinterpret_cast<const char*>(&length), sizeof(length));
+        read(0, std::min(length, headBlock));
+
+        if (length <= headBlock) { return; }
+
+        size_t rest = length - headBlock;
+        for (size_t i = 0; i < samples; i++) {
+            size_t offset = headBlock + rest / samples * i;
+            read(offset, std::min(sampleBlock, length - offset));
+        }
+        // Last block
+        read(length - std::min(rest, sampleBlock), std::min(rest, sampleBlock));
+    };
+
+    auto& buffer = m_descriptor.source.buffer();
+    if (!buffer.empty()) {
+        digest(buffer.size(), [&](size_t offset, size_t size) {
+            update(buffer.data() + offset, size);
+        });
+
+    } else if (m_descriptor.source.isUri()) {
+        std::ifstream file(m_descriptor.source.uri(), std::ios::binary | std::ios::ate);
+        size_t length = file ? size_t(file.tellg()) : 0;
+        std::vector<char> chunk;
+
+        digest(length, [&](size_t offset, size_t size) {
+            chunk.resize(size);
+            file.seekg(offset);
+            file.read(chunk.data(), size);
+            update(chunk.data(), file.gcount());
+        });
+    } else {
+        update(m_descriptor.source.uri().data(), m_descriptor.source.uri().size());
+    }
+
+    m_sourceHash = hash;
+    return m_sourceHash;
+}
+
 std::string
 FontFace::getFullName() const {
     if (m_ftFace) {
@@ -85,54 +170,36 @@ FontFace::getFullName() const {
     }
 }
 
-bool FontFace::load() {
-    if (m_loaded) {  return true; }
-    if (m_invalid) { return false; }
-
-    if (!m_descriptor.source.isValid() || m_descriptor.source.isSystemFont()) {
-        m_invalid = true;
-        return false;
-    }
-
+FT_Error FontFace::openFace(FT_Library _library, FT_Face& _ftFace, float _size) const {
     FT_Error error;
 
-    if (m_descriptor.source.hasSourceCallback()) {
-        if (!m_descriptor.source.resolveSource()) {
-            LOGE("Invalid data loaded by source callback");
-            m_invalid = true;
-            return false;
-        }
-    }
+    if (_size <= 0) { _size = m_baseSize; }
 
     if (m_descriptor.source.isUri()) {
-        error = FT_New_Face(m_ft.getLib(),
-                            m_descriptor.source.uri().c_str(),
-                            m_descriptor.faceIndex, &m_ftFace);
-        if (error) {
-            LOGE("Missing font: error: %d %s", error, m_descriptor.source.uri());
-            m_invalid = true;
-            return false;
-        }
-
+        error = FT_New_Face(_library, m_descriptor.source.uri().c_str(),
+                            m_descriptor.faceIndex, &_ftFace);
     } else {
         auto& buffer = m_descriptor.source.buffer();
-        error = FT_New_Memory_Face(m_ft.getLib(), reinterpret_cast<const FT_Byte*>(buffer.data()),
-                                   buffer.size(), m_descriptor.faceIndex, &m_ftFace);
-        if (error) {
-            LOGE("Could not create font: error: %d", error);
-            m_invalid = true;
-            return false;
-        }
+        error = FT_New_Memory_Face(_library, reinterpret_cast<const FT_Byte*>(buffer.data()),
+                                   buffer.size(), m_descriptor.faceIndex, &_ftFace);
     }
+    if (error) { return error; }
 
-    if (force_ucs2_charmap(m_ftFace)) {
+    if (force_ucs2_charmap(_ftFace)) {
         LOGE("Font is broken or irrelevant...");
         // ...but DroisSansJapan still seems to work!
-        // FT_Done_Face(m_ftFace);
-        // m_ftFace = nullptr;
+        // FT_Done_Face(_ftFace);
+        // _ftFace = nullptr;
         // return false;
     }
 
+    if (!FT_IS_SCALABLE(_ftFace) && _ftFace->num_fixed_sizes > 0) {
+        // Bitmap-only font (e.g. CBDT/sbix emoji): Glyphs are scaled to
+        // @size when rendered, see renderGlyph().
+        return FT_Select_Size(_ftFace, selectStrike(_ftFace->available_sizes,
+                                                    _ftFace->num_fixed_sizes, _size));
+    }
+
     // Docs for Pixels, points and device resolutions
     // http://www.freetype.org/freetype2/docs/glyphs/glyphs-2.html
     // - 1 point equals 1/72th of an inch
@@ -142,19 +209,56 @@ bool FontFace::load() {
 
     // This basiclly sets the pixel size since dpi == 72
     int dpi = 72;
-    FT_Set_Char_Size(m_ftFace,
-                     m_baseSize * 64, // char_width in 26.6 fixed-point
-                     m_baseSize * 64, // char_height in 26.6 fixed-point
+    FT_Set_Char_Size(_ftFace,
+                     _size * 64, // char_width in 26.6 fixed-point
+                     _size * 64, // char_height in 26.6 fixed-point
                      dpi,       // horizontal_resolution
                      dpi);      // vertical_resolution
 
+    return 0;
+}
+
+bool FontFace::load() {
+    if (m_loaded) {  return true; }
+    if (m_invalid) { return false; }
+
+    if (!m_descriptor.source.isValid() || m_descriptor.source.isSystemFont()) {
+        m_invalid = true;
+        return false;
+    }
+
+    FT_Error error;
+
+    if (m_descriptor.source.hasSourceCallback()) {
+        if (!m_descriptor.source.resolveSource()) {
+            LOGE("Invalid data loaded by source callback");
+            m_invalid = true;
+            return false;
+        }
+    }
+
+    error = openFace(m_ft.getLib(), m_ftFace);
+    if (error) {
+        if (m_descriptor.source.isUri()) {
+            LOGE("Missing font: error: %d %s", error, m_descriptor.source.uri());
+        } else {
+            LOGE("Could not create font: error: %d", error);
+        }
+        m_ftFace = nullptr;
+        m_invalid = true;
+        return false;
+    }
 
     // This must take place after ftFace is properly scaled and transformed
     m_hbFont = hb_ft_font_create(m_ftFace, nullptr);
 
-    m_metrics.height = m_ftFace->size->metrics.height / 64.f;
-    m_metrics.ascent = m_ftFace->size->metrics.ascender / 64.f;
-    m_metrics.descent = -m_ftFace->size->metrics.descender / 64.f;
+    if (!FT_IS_SCALABLE(m_ftFace) && m_ftFace->size->metrics.y_ppem > 0) {
+        m_bitmapScale = m_baseSize / m_ftFace->size->metrics.y_ppem;
+    }
+
+    m_metrics.height = m_ftFace->size->metrics.height / 64.f * m_bitmapScale;
+    m_metrics.ascent = m_ftFace->size->metrics.ascender / 64.f * m_bitmapScale;
+    m_metrics.descent = -m_ftFace->size->metrics.descender / 64.f * m_bitmapScale;
 
     m_metrics.lineThickness = m_ftFace->underline_thickness / 64.f;
     m_metrics.underlineOffset = -m_ftFace->underline_position / 64.f;
@@ -168,32 +272,155 @@ bool FontFace::load() {
     //     metrics.strikethroughOffset = 0.5f * (metrics.ascent - metrics.descent);
     // }
 
+    initGlyphFlags();
+
+    LOGI("LOADED Font: %s size: %d", getFullName(), m_baseSize);
+
+    m_loaded = true;
+    return true;
+}
+
+// Flags from the font data, computed once for all faces (i.e. sizes) of
+// one font. Faces keep the entry alive.
+struct SharedGlyphFlags {
+    InputSource source;
+    int faceIndex;
+    std::vector<uint8_t> flags;
+};
+
+static std::mutex s_sharedFlagsMutex;
+static std::vector<std::weak_ptr<const SharedGlyphFlags>> s_sharedFlags;
+
+void FontFace::initGlyphFlags() {
+    if (m_glyphFlags) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(s_sharedFlagsMutex);
+
+        for (auto it = s_sharedFlags.begin(); it != s_sharedFlags.end();) {
+            auto shared = it->lock();
+            if (!shared) {
+                it = s_sharedFlags.erase(it);
+                continue;
+            }
+            if (shared->faceIndex == m_descriptor.faceIndex &&
+                shared->source.isSameSource(m_descriptor.source) &&
+                shared->flags.size() == size_t(m_ftFace->num_glyphs)) {
+                m_sharedFlags = shared;
+                break;
+            }
+            ++it;
+        }
+    }
+
+    if (!m_sharedFlags) {
+        auto shared = std::make_shared<SharedGlyphFlags>();
+        shared->source = m_descriptor.source;
+        shared->faceIndex = m_descriptor.faceIndex;
+        shared->flags = computeGlyphFlags();
+        m_sharedFlags = shared;
+
+        std::lock_guard<std::mutex> lock(s_sharedFlagsMutex);
+        s_sharedFlags.push_back(shared);
+    }
+
+    // Per face: setEmpty() depends on the size
+    auto& flags = m_sharedFlags->flags;
+    m_glyphFlags.reset(new std::atomic<uint8_t>[flags.size()]);
+    for (size_t i = 0; i < flags.size(); i++) {
+        m_glyphFlags[i].store(flags[i], std::memory_order_relaxed);
+    }
+    m_glyphCount = flags.size();
+
+    m_glyphExtents.reset(new Extents[m_glyphCount]);
+    m_extentsReady.reset(new std::atomic<bool>[m_glyphCount]);
+    for (size_t i = 0; i < m_glyphCount; i++) {
+        m_extentsReady[i].store(false, std::memory_order_relaxed);
+    }
+}
+
+std::vector<uint8_t> FontFace::computeGlyphFlags() const {
+    std::vector<uint8_t> flags(m_ftFace->num_glyphs, 0);
+
     // The following is necessary because the codepoints provided by
     // freetype for space-separators are somehow not unicode values, e.g.
     // depending on the font, the codepoint for a "regular space" can be
     // 2 or 3 (instead of 32)
-    if (m_spaceSeparators.empty()) {
-        for (size_t i = 0; i < SPACE_SEPARATORS_COUNT; i++) {
-            auto codepoint = static_cast<hb_codepoint_t>(
-                FT_Get_Char_Index(m_ftFace, SPACE_SEPARATORS[i]));
-
-            if (codepoint) {
-                if (std::find(m_spaceSeparators.begin(),
-                              m_spaceSeparators.end(),
-                              codepoint) == m_spaceSeparators.end()) {
-                    m_spaceSeparators.push_back(codepoint);
-                }
+    for (size_t i = 0; i < SPACE_SEPARATORS_COUNT; i++) {
+        auto glyph = FT_Get_Char_Index(m_ftFace, SPACE_SEPARATORS[i]);
+        if (glyph && glyph < flags.size()) {
+            flags[glyph] |= GlyphFlag::space | GlyphFlag::empty;
+        }
+    }
+
+    auto hasTable = [&](FT_ULong tag) {
+        FT_ULong length = 0;
+        return FT_Load_Sfnt_Table(m_ftFace, tag, 0, nullptr, &length) == 0;
+    };
+
+    // Glyphs of bitmap strikes and color tables may have no outline
+    // but still render
+    bool outlineOnly = m_ftFace->num_fixed_sizes == 0 &&
+        !hasTable(TTAG_sbix) && !hasTable(TTAG_CBDT) && !hasTable(TTAG_EBDT) &&
+        !hasTable(TTAG_bdat) && !hasTable(TTAG_COLR);
+
+    // TrueType glyphs without outline have a zero-length entry in 'loca'
+    auto head = static_cast<TT_Header*>(FT_Get_Sfnt_Table(m_ftFace, FT_SFNT_HEAD));
+    FT_ULong length = 0;
+
+    if (outlineOnly && head &&
+        FT_Load_Sfnt_Table(m_ftFace, TTAG_loca, 0, nullptr, &length) == 0) {
+        std::vector<FT_Byte> loca(length);
+        FT_Load_Sfnt_Table(m_ftFace, TTAG_loca, 0, loca.data(), &length);
+
+        bool longOffsets = head->Index_To_Loc_Format != 0;
+        size_t entrySize = longOffsets ? 4 : 2;
+
+        auto offset = [&](size_t i) -> uint32_t {
+            const FT_Byte* p = &loca[i * entrySize];
+            if (longOffsets) {
+                return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+                       (uint32_t(p[2]) << 8) | uint32_t(p[3]);
             }
+            return (uint32_t(p[0]) << 8) | uint32_t(p[1]);
+        };
+
+        // 'loca' has numGlyphs + 1 entries
+        size_t entries = length / entrySize;
+        size_t count = entries ? std::min(flags.size(), entries - 1) : 0;
+        for (size_t i = 0; i < count; i++) {
+            if (offset(i) == offset(i + 1)) { flags[i] |= GlyphFlag::empty; }
         }
     }
 
-    LOGI("LOADED Font: %s size: %d", getFullName(), m_baseSize);
+    if (FT_HAS_COLOR(m_ftFace)) {
+        if (!FT_IS_SCALABLE(m_ftFace)) {
+            // Bitmap-only color font (CBDT/sbix)
+            for (auto& f : flags) {
+                if (!(f & GlyphFlag::empty)) { f |= GlyphFlag::color; }
+            }
+        } else {
+#if (FREETYPE_MAJOR * 100 + FREETYPE_MINOR) >= 210
+            // Glyphs with COLR layers
+            for (size_t i = 0; i < flags.size(); i++) {
+                FT_UInt layerGlyph, colorIndex;
+                FT_LayerIterator it;
+                it.p = nullptr;
+                if (FT_Get_Color_Glyph_Layer(m_ftFace, i, &layerGlyph, &colorIndex, &it)) {
+                    flags[i] |= GlyphFlag::color;
+                }
+            }
+#endif
+        }
+    }
 
-    m_loaded = true;
-    return true;
+    return flags;
 }
 
 void FontFace::unload() {
+    // Rasterizer instances of the face are closed first
+    notifyObservers(false);
+
     if (m_loaded) {
         m_loaded = false;
 
@@ -205,14 +432,75 @@ void FontFace::unload() {
     }
 }
 
+auto FontFace::glyphExtents(hb_codepoint_t _glyph) const -> const Extents& {
+    static const Extents none = { {0, 0}, {0, 0} };
+
+    if (!m_loaded || _glyph >= m_glyphCount || isEmpty(_glyph)) { return none; }
+
+    auto& extents = m_glyphExtents[_glyph];
+    if (m_extentsReady[_glyph].load(std::memory_order_acquire)) { return extents; }
+
+    // Loads the glyph into the FT_Face of the face, one at a time
+    std::lock_guard<std::mutex> lock(m_extentsMutex);
+    if (m_extentsReady[_glyph].load(std::memory_order_relaxed)) { return extents; }
+
+    hb_glyph_extents_t e;
+    if (!hb_font_get_glyph_extents(m_hbFont, _glyph, &e)) {
+        extents = none;
+    } else {
+        // 26.6 at the size of the face or bitmap strike, y up
+        float scale = m_bitmapScale / 64.f;
+        extents.offset = { e.x_bearing * scale, -e.y_bearing * scale };
+        extents.size = { e.width * scale, -e.height * scale };
+    }
+    m_extentsReady[_glyph].store(true, std::memory_order_release);
+
+    return extents;
+}
+
 const GlyphData* FontFace::createGlyph(hb_codepoint_t codepoint) const {
 
     if (!m_loaded)
         return nullptr;
 
-    // FIXME mutex
+    // Not thread-safe: Renders into the GlyphData shared by all faces of
+    // FreetypeHelper. See GlyphRasterizer for rendering on multiple threads.
+    auto* glyphData = m_ft.loadGlyph(m_ftFace, codepoint);
+    if (!glyphData) { setEmpty(codepoint); }
+
+    return glyphData;
+}
+
+bool FontFace::createGlyph(hb_codepoint_t _codepoint, GlyphBitmap& _bitmap,
+                           float _stroke) const {
+
+    if (!m_loaded) { return false; }
+
+    return renderGlyph(m_ftFace, _codepoint, _bitmap, 0, _stroke);
+}
+
+bool FontFace::renderGlyph(FT_Face _ftFace, hb_codepoint_t _codepoint,
+                           GlyphBitmap& _bitmap, float _size, float _stroke) const {
 
-    return m_ft.loadGlyph(m_ftFace, codepoint);
+    if (isEmpty(_codepoint)) {
+        _bitmap.empty = true;
+        return false;
+    }
+
+    if (_stroke > 0) { return _bitmap.loadStrokedGlyph(_ftFace, _codepoint, _stroke); }
+
+    bool color = glyphFlags(_codepoint) & GlyphFlag::color;
+    if (!_bitmap.loadGlyph(_ftFace, _codepoint, color)) { return false; }
+
+    // Glyph comes from a bitmap strike (see openFace)
+    if (!FT_IS_SCALABLE(_ftFace) && _ftFace->size->metrics.y_ppem > 0) {
+        if (_size <= 0) { _size = m_baseSize; }
+
+        // Up when even the largest strike is smaller than @size
+        float scale = _size / _ftFace->size->metrics.y_ppem;
+        if (scale != 1) { _bitmap.scale(scale); }
+    }
+    return true;
 }
 
 
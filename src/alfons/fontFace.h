@@ -18,18 +18,35 @@
 
 #include "hb.h"
 
+#include <atomic>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <tuple>
 
 namespace alfons {
 
 class Alfons;
 struct GlyphData;
+struct GlyphBitmap;
+struct SharedGlyphFlags;
 struct Shape;
 
 using FaceID = uint16_t;
 
+class FontFace;
+
+// Drops resources that refer to a face, see FontFace::addObserver()
+class FaceObserver {
+public:
+    virtual ~FaceObserver() {}
+
+    // @face was unloaded - or is about to be destroyed when @destroyed.
+    // Called with the observers of @face locked: must not add or remove
+    // observers of @face.
+    virtual void faceUnloaded(const FontFace& face, bool destroyed) = 0;
+};
+
 class FontFace {
 public:
     struct Descriptor {
@@ -79,22 +96,107 @@ public:
     };
 
 
+    // Per-glyph properties, indexed by glyph id (see initGlyphFlags)
+    enum GlyphFlag : uint8_t {
+        // Unicode space separator (may also be set for other blank glyphs)
+        space = 1 << 0,
+        // Glyph has no outline or bitmap - it only contributes its advance
+        empty = 1 << 1,
+        // Glyph has color layers or comes from a color bitmap strike
+        color = 1 << 2,
+    };
+
+    // Ink box of a glyph in pixels at the face size, relative to the glyph
+    // origin with y down - like Glyph::offset and Glyph::size
+    struct Extents {
+        glm::vec2 offset;
+        glm::vec2 size;
+    };
+
     FontFace(FreetypeHelper& _ft, FaceID faceId,
              const Descriptor& descriptor, float baseSize);
 
     virtual ~FontFace();
 
-    bool isSpace(hb_codepoint_t codepoint) const;
+    uint8_t glyphFlags(hb_codepoint_t glyph) const {
+        return glyph < m_glyphCount ?
+            m_glyphFlags[glyph].load(std::memory_order_relaxed) : 0;
+    }
+
+    bool isSpace(hb_codepoint_t glyph) const {
+        return glyphFlags(glyph) & GlyphFlag::space;
+    }
+
+    bool isEmpty(hb_codepoint_t glyph) const {
+        return glyphFlags(glyph) & GlyphFlag::empty;
+    }
+
+    // Record that @glyph rendered without pixels. For fonts without
+    // a 'loca' table this is only known after the first rasterization.
+    // Safe to call while other threads read the flags.
+    void setEmpty(hb_codepoint_t glyph) const {
+        if (glyph < m_glyphCount) {
+            m_glyphFlags[glyph].fetch_or(GlyphFlag::empty, std::memory_order_relaxed);
+        }
+    }
+
+    // Ink box of @glyph from hb_font_get_glyph_extents(), cached per face.
+    // Zero for empty glyphs. Thread-safe: lookups of new glyphs are
+    // serialized, cached ones are read without lock.
+    const Extents& glyphExtents(hb_codepoint_t glyph) const;
+
     hb_codepoint_t getCodepoint(FT_ULong charCode) const;
     std::string getFullName() const;
 
     virtual bool load();
     void unload();
 
+    // Notify @observer when the face is unloaded or destroyed. Observers
+    // are dropped when the face is destroyed; when they go first they must
+    // remove themselves. Thread-safe, adding an observer twice is a no-op.
+    void addObserver(FaceObserver* observer) const;
+    void removeObserver(FaceObserver* observer) const;
+
     const GlyphData* createGlyph(hb_codepoint_t codepoint) const;
 
+    // Render @codepoint into an owned @bitmap, with a halo of @stroke
+    // pixels when given (see renderGlyph). Not thread-safe.
+    bool createGlyph(hb_codepoint_t codepoint, GlyphBitmap& bitmap, float stroke = 0) const;
+
+    // Open another FT_Face instance for this face in @library, with the
+    // same charmap and size - or @size when given. Used to render glyphs
+    // on other threads - the face must have been loaded before.
+    FT_Error openFace(FT_Library library, FT_Face& ftFace, float size = 0) const;
+
+    // Render @codepoint with @ftFace (see openFace) into @bitmap. Color
+    // glyphs are rendered as BGRA, glyphs of bitmap strikes are scaled
+    // to @size (or the face size). With @stroke > 0 the coverage of the
+    // outline grown by @stroke pixels is rendered instead - the halo glyph.
+    // Thread-safe as long as @ftFace is only used by the calling thread.
+    bool renderGlyph(FT_Face ftFace, hb_codepoint_t codepoint, GlyphBitmap& bitmap,
+                     float size = 0, float stroke = 0) const;
+
     FaceID id() const { return m_id; }
 
+    // Pixel size
+    float size() const { return m_baseSize; }
+
+    // Scale from the selected bitmap strike to the face size. Applies to
+    // shaping results and glyph metrics of bitmap-only fonts, 1 otherwise.
+    float bitmapScale() const { return m_bitmapScale; }
+
+    int faceIndex() const { return m_descriptor.faceIndex; }
+
+    // Digest of the font data: length, table directory and sampled blocks.
+    // Identifies the font file across processes.
+    uint64_t sourceHash() const;
+
+    // Whether @other is loaded from the same font data
+    bool hasSameSource(const FontFace& other) const {
+        return m_descriptor.faceIndex == other.m_descriptor.faceIndex &&
+            m_descriptor.source.isSameSource(other.m_descriptor.source);
+    }
+
     hb_font_t* hbFont() const  { return m_hbFont; }
 
     const Metrics& metrics() const { return m_metrics; }
@@ -118,6 +220,7 @@ protected:
 
     Descriptor m_descriptor;
     float m_baseSize;
+    float m_bitmapScale = 1;
 
     Metrics m_metrics;
     bool m_loaded;
@@ -126,11 +229,36 @@ protected:
     FT_Face m_ftFace;
     hb_font_t* m_hbFont;
 
-    std::vector<hb_codepoint_t> m_spaceSeparators;
+    // Written once by load(), later only by setEmpty() while shaping and
+    // rasterizer threads read them: atomic bytes, relaxed order
+    std::unique_ptr<std::atomic<uint8_t>[]> m_glyphFlags;
+    size_t m_glyphCount = 0;
+
+    // Indexed by glyph id, allocated by load(). Entries are written once
+    // under m_extentsMutex and published by m_extentsReady.
+    std::unique_ptr<Extents[]> m_glyphExtents;
+    std::unique_ptr<std::atomic<bool>[]> m_extentsReady;
+    mutable std::mutex m_extentsMutex;
+
+    mutable uint64_t m_sourceHash = 0;
+
+    // See addObserver()
+    mutable std::vector<FaceObserver*> m_observers;
+    mutable std::mutex m_observersMutex;
+
+    void notifyObservers(bool destroyed);
 
     std::vector<hb_script_t> m_scripts;
     std::vector<hb_language_t> m_languages;
 
+    // Set up the per-glyph tables. Flags are computed once per font file
+    // and face index, other faces (sizes) of it copy them.
+    void initGlyphFlags();
+
+    std::vector<uint8_t> computeGlyphFlags() const;
+
+    std::shared_ptr<const SharedGlyphFlags> m_sharedFlags;
+
     static FT_Error force_ucs2_charmap(FT_Face face);
 };
 
@@ -17,40 +17,66 @@
 
 namespace alfons {
 
-std::shared_ptr<Font> FontManager::addFont(std::string _name, Font::Properties _properties,
-                                           InputSource _source) {
+FontName FontManager::fontName(const std::string& _name) {
 
-    auto key = make_pair(_name, _properties);
-    auto it = m_fonts.find(key);
+    if (auto id = m_names.find(_name)) { return *id; }
 
-    if (it != m_fonts.end()) {
-        return it->second;
-    }
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-    auto font = std::make_shared<Font>(_properties);
-    m_fonts.emplace(std::move(key), font);
+    // Returns the id when another writer added it in the meantime
+    return m_names.insert(_name, FontName(m_names.size()));
+}
+
+std::shared_ptr<Font> FontManager::findFont(const FontKey& _key) const {
+
+    if (auto font = m_fonts.find(_key)) { return *font; }
+
+    return nullptr;
+}
+
+std::shared_ptr<Font> FontManager::insertFont(const FontKey& _key, InputSource& _source) {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (auto font = m_fonts.find(_key)) { return *font; }
+
+    auto font = std::make_shared<Font>(_key.properties);
 
     if (_source.isValid()) {
         auto descriptor = FontFace::Descriptor(_source, 0, 1);
-        font->addFace(addFontFace(descriptor, _properties.baseSize));
+        font->addFace(createFontFace(descriptor, _key.properties.baseSize));
     }
 
-    return font;
+    return m_fonts.insert(_key, font);
 }
 
-std::shared_ptr<Font> FontManager::getFont(std::string _name, Font::Properties _properties) {
+std::shared_ptr<Font> FontManager::addFont(const std::string& _name, Font::Properties _properties,
+                                           InputSource _source) {
+    return addFont(fontName(_name), _properties, std::move(_source));
+}
 
-    auto key = make_pair(_name, _properties);
-    auto it = m_fonts.find(key);
+std::shared_ptr<Font> FontManager::addFont(FontName _name, Font::Properties _properties,
+                                           InputSource _source) {
 
-    if (it != m_fonts.end()) {
-        return it->second;
-    }
+    FontKey key{_name, _properties};
 
-    auto font = std::make_shared<Font>(_properties);
-    m_fonts.emplace(std::move(key), font);
+    if (auto font = findFont(key)) { return font; }
 
-    return font;
+    return insertFont(key, _source);
+}
+
+std::shared_ptr<Font> FontManager::getFont(const std::string& _name, Font::Properties _properties) {
+    return getFont(fontName(_name), _properties);
+}
+
+std::shared_ptr<Font> FontManager::getFont(FontName _name, Font::Properties _properties) {
+
+    FontKey key{_name, _properties};
+
+    if (auto font = findFont(key)) { return font; }
+
+    InputSource noSource;
+    return insertFont(key, noSource);
 }
 
 #if 0
@@ -143,15 +169,17 @@ void FontManager::unload(Font& font) {
     //     if (it->second == font) { m_fonts.erase(it); }
     // }
 
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     std::set<FaceID> inUse;
 
-    for (auto& font : m_fonts) {
-        for (auto& entry : font.second->fontFaceMap()) {
+    m_fonts.forEach([&](const FontKey&, const std::shared_ptr<Font>& font) {
+        for (auto& entry : font->fontFaceMap()) {
             for (auto& face : entry.second) {
                 inUse.insert(face->id());
             }
         }
-    }
+    });
 
     for (auto& face : m_faces) {
         if (!inUse.count(face->id())) {
@@ -162,6 +190,8 @@ void FontManager::unload(Font& font) {
 
 void FontManager::unload() {
 
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     for (auto& face : m_faces) {
         face->unload();
     }
@@ -170,6 +200,14 @@ void FontManager::unload() {
 std::shared_ptr<FontFace> FontManager::addFontFace(const FontFace::Descriptor& descriptor,
                                                    float baseSize) {
 
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return createFontFace(descriptor, baseSize);
+}
+
+std::shared_ptr<FontFace> FontManager::createFontFace(const FontFace::Descriptor& descriptor,
+                                                      float baseSize) {
+
     if (m_maxFontId == std::numeric_limits<uint16_t>::max()) {
         LOGE("addFontFace failed: Reached maximum FontFace ID");
         return nullptr;
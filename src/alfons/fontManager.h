@@ -10,21 +10,40 @@
 
 #pragma once
 
+#include "concurrentTable.h"
 #include "font.h"
 #include "inputSource.h"
 
+#include <mutex>
+#include <string>
+
 namespace alfons {
 
+// Interned font name, see FontManager::fontName()
+using FontName = uint32_t;
+
+/*
+ * Font lookups are safe to call from multiple threads: Readers probe
+ * insert-only tables of immutable entries (see ConcurrentTable) and never
+ * take a lock. Writers (adding names, fonts or faces) are serialized.
+ */
 class FontManager {
 
 public:
 
     ~FontManager() {}
 
+    FontName fontName(const std::string& _name);
+
+    std::shared_ptr<Font> addFont(const std::string& _name, Font::Properties _properties,
+                                  InputSource _source = {});
+
+    std::shared_ptr<Font> addFont(FontName _name, Font::Properties _properties,
+                                  InputSource _source = {});
 
-    std::shared_ptr<Font> addFont(std::string _name, Font::Properties _properties, InputSource _source = {});
+    std::shared_ptr<Font> getFont(const std::string& _name, Font::Properties _properties);
 
-    std::shared_ptr<Font> getFont(std::string _name, Font::Properties _properties);
+    std::shared_ptr<Font> getFont(FontName _name, Font::Properties _properties);
 
 #if 0
     std::shared_ptr<Font> addFont(std::string name, std::string path, float baseSize,
@@ -75,10 +94,38 @@ private:
     // std::map<std::string, std::string> m_aliases;
 #endif
 
-    // Path and Properties
-    using FontKey = std::pair<std::string, Font::Properties>;
+    struct FontKey {
+        FontName name;
+        Font::Properties properties;
+
+        bool operator==(const FontKey& other) const {
+            return name == other.name &&
+                properties.baseSize == other.properties.baseSize &&
+                properties.style == other.properties.style;
+        }
+    };
+
+    struct FontKeyHash {
+        size_t operator()(const FontKey& k) const {
+            size_t h = std::hash<float>()(k.properties.baseSize);
+            h ^= (size_t(k.name) << 3 | size_t(k.properties.style)) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    // Inserted into under m_mutex
+    ConcurrentTable<std::string, FontName> m_names;
+    ConcurrentTable<FontKey, std::shared_ptr<Font>, FontKeyHash> m_fonts;
+
+    std::shared_ptr<Font> findFont(const FontKey& _key) const;
+
+    std::shared_ptr<Font> insertFont(const FontKey& _key, InputSource& _source);
+
+    // Requires m_mutex to be held
+    std::shared_ptr<FontFace> createFontFace(const FontFace::Descriptor& descriptor, float baseSize);
 
-    std::map<FontKey, std::shared_ptr<Font>> m_fonts;
+    // Serializes writers
+    std::mutex m_mutex;
 
     std::vector<std::shared_ptr<FontFace>> m_faces;
 
@@ -12,8 +12,12 @@
 
 #include <ft2build.h>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 #include FT_GLYPH_H
+#include FT_STROKER_H
 #include FT_TRUETYPE_TABLES_H
 
 namespace alfons {
@@ -40,15 +44,38 @@ struct GlyphData {
         return nullptr;
     }
 
+    // Bytes between rows of getTopRow(), may be larger than the width
+    // or negative (upward flow)
+    int getPitch() const {
+        return ftGlyph ? ftSlot->bitmap.pitch : 0;
+    }
+
+    // First row of the glyph image. Unlike getBuffer() also correct
+    // for negative pitch, where the top row is at the end of the buffer.
+    const unsigned char* getTopRow() const {
+        if (!ftGlyph)
+            return nullptr;
+
+        auto& bitmap = ftSlot->bitmap;
+        if (bitmap.pitch < 0)
+            return bitmap.buffer - int(bitmap.rows - 1) * bitmap.pitch;
+
+        return bitmap.buffer;
+    }
+
     std::vector<unsigned char> getBufferCopy() {
         if (!ftGlyph)
             return {};
 
-        int dataSize = (x1 - x0) * (y1 - y0);
+        int w = x1 - x0;
+        int h = y1 - y0;
         std::vector<unsigned char> data;
-        data.resize(dataSize);
+        data.resize(w * h);
 
-        memcpy(&data[0], ftSlot->bitmap.buffer, dataSize);
+        const unsigned char* top = getTopRow();
+        for (int row = 0; row < h; row++) {
+            memcpy(&data[row * w], top + row * getPitch(), w);
+        }
         FT_Done_Glyph(ftGlyph);
         ftGlyph = nullptr;
 
@@ -94,6 +121,228 @@ struct GlyphData {
     FT_GlyphSlot ftSlot;
 };
 
+// Owned copy of a rendered glyph: Unlike GlyphData it stays valid after
+// the next glyph was loaded and may be passed between threads.
+struct GlyphBitmap {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    // Bytes per pixel
+    int channels = 1;
+
+    // Tightly packed rows of (x1 - x0) * channels bytes
+    std::vector<unsigned char> buffer;
+
+    // Set when the glyph was rendered but has no pixels. Invalid bitmaps
+    // without this flag could not be rendered.
+    bool empty = false;
+
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+
+    bool isValid() const { return !buffer.empty(); }
+
+    // Render @codepoint. With @color, glyphs with color layers or from
+    // color bitmap strikes are loaded as premultiplied BGRA (4 channels).
+    bool loadGlyph(FT_Face ftFace, FT_UInt codepoint, bool color = false) {
+        buffer.clear();
+        channels = 1;
+        empty = false;
+
+        if (codepoint == 0)
+            return false;
+
+        FT_Int32 flags = FT_LOAD_DEFAULT |
+            (color ? FT_LOAD_COLOR : FT_LOAD_FORCE_AUTOHINT);
+
+        if (FT_Load_Glyph(ftFace, codepoint, flags) != 0)
+            return false;
+
+        FT_GlyphSlot slot = ftFace->glyph;
+
+        if (FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL) != 0)
+            return false;
+
+        return copyBitmap(slot->bitmap, slot->bitmap_left, slot->bitmap_top);
+    }
+
+    // Render the outline of @codepoint dilated by @stroke pixels, i.e. the
+    // glyph with a halo of that width. Fails for glyphs without outline.
+    bool loadStrokedGlyph(FT_Face ftFace, FT_UInt codepoint, float stroke) {
+        buffer.clear();
+        channels = 1;
+        empty = false;
+
+        if (codepoint == 0)
+            return false;
+
+        if (FT_Load_Glyph(ftFace, codepoint, FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP |
+                          FT_LOAD_FORCE_AUTOHINT) != 0)
+            return false;
+
+        if (ftFace->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+            return false;
+
+        FT_Glyph glyph;
+        if (FT_Get_Glyph(ftFace->glyph, &glyph) != 0)
+            return false;
+
+        FT_Stroker stroker;
+        if (FT_Stroker_New(ftFace->glyph->library, &stroker) != 0) {
+            FT_Done_Glyph(glyph);
+            return false;
+        }
+        FT_Stroker_Set(stroker, FT_Fixed(stroke * 64), FT_STROKER_LINECAP_ROUND,
+                       FT_STROKER_LINEJOIN_ROUND, 0);
+
+        // Outside border: the outline grown by the stroke radius
+        bool ok = FT_Glyph_StrokeBorder(&glyph, stroker, false, true) == 0 &&
+            FT_Glyph_To_Bitmap(&glyph, FT_RENDER_MODE_NORMAL, nullptr, true) == 0;
+
+        FT_Stroker_Done(stroker);
+
+        if (ok) {
+            auto bitmapGlyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
+            ok = copyBitmap(bitmapGlyph->bitmap, bitmapGlyph->left, bitmapGlyph->top);
+        }
+        FT_Done_Glyph(glyph);
+
+        return ok;
+    }
+
+    // Copy @bitmap with origin @left, @top into buffer
+    bool copyBitmap(const FT_Bitmap& bitmap, int left, int top) {
+        if (bitmap.width <= 0 || bitmap.rows <= 0) {
+            empty = true;
+            return false;
+        }
+
+        x0 = left;
+        x1 = x0 + bitmap.width;
+        y0 = -top;
+        y1 = y0 + bitmap.rows;
+
+        // Copy row by row, pitch may be larger than width. For negative
+        // pitch (upward flow) the top row is at the end of the buffer.
+        const unsigned char* topRow = bitmap.buffer;
+        if (bitmap.pitch < 0) { topRow -= int(bitmap.rows - 1) * bitmap.pitch; }
+
+        switch (bitmap.pixel_mode) {
+        case FT_PIXEL_MODE_GRAY:
+        case FT_PIXEL_MODE_BGRA: {
+            channels = bitmap.pixel_mode == FT_PIXEL_MODE_BGRA ? 4 : 1;
+            size_t row = bitmap.width * channels;
+
+            buffer.resize(row * bitmap.rows);
+            for (unsigned int y = 0; y < bitmap.rows; y++) {
+                memcpy(&buffer[y * row], topRow + int(y) * bitmap.pitch, row);
+            }
+            break;
+        }
+        case FT_PIXEL_MODE_MONO:
+            // 1 bit per pixel, e.g. from bitmap strikes
+            buffer.resize(bitmap.width * bitmap.rows);
+            for (unsigned int y = 0; y < bitmap.rows; y++) {
+                const unsigned char* src = topRow + int(y) * bitmap.pitch;
+                for (unsigned int x = 0; x < bitmap.width; x++) {
+                    bool set = src[x >> 3] & (0x80 >> (x & 7));
+                    buffer[y * bitmap.width + x] = set ? 255 : 0;
+                }
+            }
+            break;
+        default:
+            return false;
+        }
+        return true;
+    }
+
+    // Resample by @scale, e.g. glyphs from bitmap strikes of another size
+    // than the font size: With a box filter when @scale < 1, bilinear
+    // otherwise.
+    void scale(float scale) {
+        int w = width();
+        int h = height();
+        int sw = std::max(1, int(std::lround(w * scale)));
+        int sh = std::max(1, int(std::lround(h * scale)));
+
+        std::vector<unsigned char> scaled(sw * sh * channels);
+
+        if (scale < 1) {
+            for (int y = 0; y < sh; y++) {
+                int ya = y * h / sh;
+                int yb = std::max(ya + 1, (y + 1) * h / sh);
+
+                for (int x = 0; x < sw; x++) {
+                    int xa = x * w / sw;
+                    int xb = std::max(xa + 1, (x + 1) * w / sw);
+                    int n = (xb - xa) * (yb - ya);
+
+                    for (int c = 0; c < channels; c++) {
+                        int sum = 0;
+                        for (int sy = ya; sy < yb; sy++) {
+                            for (int sx = xa; sx < xb; sx++) {
+                                sum += buffer[(sy * w + sx) * channels + c];
+                            }
+                        }
+                        scaled[(y * sw + x) * channels + c] = (sum + n / 2) / n;
+                    }
+                }
+            }
+        } else {
+            // Sample at pixel centers, clamped to the edge pixels
+            auto sample = [](int i, int n, int sn, int& a, int& b, float& t) {
+                float f = std::min(std::max((i + 0.5f) * n / sn - 0.5f, 0.f), float(n - 1));
+                a = int(f);
+                b = std::min(a + 1, n - 1);
+                t = f - a;
+            };
+
+            for (int y = 0; y < sh; y++) {
+                int ya, yb;
+                float ty;
+                sample(y, h, sh, ya, yb, ty);
+
+                for (int x = 0; x < sw; x++) {
+                    int xa, xb;
+                    float tx;
+                    sample(x, w, sw, xa, xb, tx);
+
+                    for (int c = 0; c < channels; c++) {
+                        auto px = [&](int sx, int sy) {
+                            return float(buffer[(sy * w + sx) * channels + c]);
+                        };
+                        float top = px(xa, ya) + (px(xb, ya) - px(xa, ya)) * tx;
+                        float bottom = px(xa, yb) + (px(xb, yb) - px(xa, yb)) * tx;
+                        scaled[(y * sw + x) * channels + c] =
+                            (unsigned char)std::lround(top + (bottom - top) * ty);
+                    }
+                }
+            }
+        }
+
+        buffer.swap(scaled);
+
+        x0 = int(std::lround(x0 * scale));
+        y0 = int(std::lround(y0 * scale));
+        x1 = x0 + sw;
+        y1 = y0 + sh;
+    }
+};
+
+// Index of the bitmap strike in @sizes to render @size pixels from: the
+// smallest strike that is not smaller than @size, or the largest one.
+inline int selectStrike(const FT_Bitmap_Size* sizes, int count, float size) {
+    int best = 0;
+    for (int i = 1; i < count; i++) {
+        float ppem = sizes[i].y_ppem / 64.f;
+        float bestPpem = sizes[best].y_ppem / 64.f;
+        if ((bestPpem < size && ppem > bestPpem) ||
+            (ppem >= size && ppem < bestPpem)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
 class FreetypeHelper {
 
     GlyphData glyphData;
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace alfons {
+
+// Flat open-addressing hash table from 64-bit keys to 32-bit values.
+// Linear probing in a power-of-two table, load factor at most 1/2.
+// Erase shifts following entries back, so there are no tombstones.
+class GlyphIndex {
+
+public:
+    static constexpr uint32_t npos = ~0u;
+
+    // Finalizer of MurmurHash3 - spreads keys that differ only in a few
+    // low bits (e.g. neighboring glyph ids of one face) over the table
+    static uint64_t hash(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    // Returns npos when @key is not found
+    uint32_t find(uint64_t key) const {
+        if (m_count == 0) { return npos; }
+
+        for (size_t i = hash(key) & m_mask;; i = (i + 1) & m_mask) {
+            auto& slot = m_slots[i];
+            if (slot.key == key) { return slot.value; }
+            if (slot.key == empty) { return npos; }
+        }
+    }
+
+    // Insert or replace the value for @key
+    void insert(uint64_t key, uint32_t value) {
+        if ((m_count + 1) * 2 > m_slots.size()) {
+            rehash(m_slots.empty() ? 64 : m_slots.size() * 2);
+        }
+
+        size_t i = hash(key) & m_mask;
+        while (m_slots[i].key != empty && m_slots[i].key != key) {
+            i = (i + 1) & m_mask;
+        }
+        if (m_slots[i].key == empty) { m_count++; }
+
+        m_slots[i] = { key, value };
+    }
+
+    bool erase(uint64_t key) {
+        if (m_count == 0) { return false; }
+
+        size_t i = hash(key) & m_mask;
+        while (m_slots[i].key != key) {
+            if (m_slots[i].key == empty) { return false; }
+            i = (i + 1) & m_mask;
+        }
+
+        // Move back entries of the probe sequence that would no longer be
+        // reachable from their home slot
+        for (size_t j = (i + 1) & m_mask; m_slots[j].key != empty; j = (j + 1) & m_mask) {
+            size_t home = hash(m_slots[j].key) & m_mask;
+            if (((j - home) & m_mask) >= ((j - i) & m_mask)) {
+                m_slots[i] = m_slots[j];
+                i = j;
+            }
+        }
+        m_slots[i].key = empty;
+        m_count--;
+
+        return true;
+    }
+
+    void clear() {
+        m_slots.clear();
+        m_mask = 0;
+        m_count = 0;
+    }
+
+    size_t size() const { return m_count; }
+
+private:
+    // Not a valid key: GlyphKey::font and codepoint are never both ~0
+    static constexpr uint64_t empty = ~0ULL;
+
+    struct Slot {
+        uint64_t key;
+        uint32_t value;
+    };
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> slots(capacity, Slot{ empty, 0 });
+        m_slots.swap(slots);
+        m_mask = capacity - 1;
+        m_count = 0;
+
+        for (auto& slot : slots) {
+            if (slot.key != empty) { insert(slot.key, slot.value); }
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    size_t m_mask = 0;
+    size_t m_count = 0;
+};
+
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#include "glyphRasterizer.h"
+#include "sdf.h"
+#include "msdf.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace alfons {
+
+static uint64_t faceKey(FaceID _face, float _size) {
+    uint32_t size;
+    memcpy(&size, &_size, sizeof(size));
+    return (uint64_t(_face) << 32) | size;
+}
+
+GlyphRasterizer::GlyphRasterizer(size_t _workers)
+    : m_threaded(_workers > 0) {
+
+    _workers = std::max<size_t>(_workers, 1);
+
+    for (size_t i = 0; i < _workers; i++) {
+        m_workers.push_back(std::make_unique<Worker>());
+        auto& worker = *m_workers.back();
+
+        if (FT_Init_FreeType(&worker.library) != 0) {
+            LOGE("Could not initialize FreeType for rasterizer thread");
+            worker.library = nullptr;
+        }
+        if (m_threaded) {
+            worker.thread = std::thread(&GlyphRasterizer::run, this, std::ref(worker));
+        }
+    }
+}
+
+GlyphRasterizer::~GlyphRasterizer() {
+    std::unordered_set<const FontFace*> observed;
+    {
+        std::lock_guard<std::mutex> lock(m_observedMutex);
+        std::swap(observed, m_observed);
+    }
+    for (auto* face : observed) { face->removeObserver(this); }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wakeup.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) { worker->thread.join(); }
+
+        for (auto& face : worker->faces) { FT_Done_Face(face.second); }
+
+        if (worker->library) { FT_Done_FreeType(worker->library); }
+    }
+}
+
+FT_Face GlyphRasterizer::Worker::getFace(const FontFace& _face, float _size) {
+    auto key = faceKey(_face.id(), _size);
+    auto it = faces.find(key);
+    if (it != faces.end()) { return it->second; }
+
+    FT_Face ftFace = nullptr;
+    if (!library || _face.openFace(library, ftFace, _size) != 0) {
+        ftFace = nullptr;
+    }
+    // Also remember failures
+    faces.emplace(key, ftFace);
+
+    return ftFace;
+}
+
+void GlyphRasterizer::rasterize(const std::vector<GlyphRequest>& _requests,
+                                std::vector<GlyphBitmap>& _bitmaps) {
+
+    _bitmaps.clear();
+    _bitmaps.resize(_requests.size());
+
+    if (_requests.empty()) { return; }
+
+    // Observe new faces to close their instances on unload
+    const FontFace* lastFace = nullptr;
+    for (auto& request : _requests) {
+        if (request.face == lastFace) { continue; }
+        lastFace = request.face;
+
+        {
+            std::lock_guard<std::mutex> lock(m_observedMutex);
+            if (m_observed.count(lastFace)) { continue; }
+        }
+        lastFace->addObserver(this);
+
+        std::lock_guard<std::mutex> lock(m_observedMutex);
+        m_observed.insert(lastFace);
+    }
+
+    std::lock_guard<std::mutex> job(m_jobMutex);
+
+    if (!m_threaded) {
+        m_requests = &_requests;
+        m_bitmaps = &_bitmaps;
+        m_next = 0;
+
+        process(*m_workers.front());
+
+        m_requests = nullptr;
+        m_bitmaps = nullptr;
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_requests = &_requests;
+    m_bitmaps = &_bitmaps;
+    m_next = 0;
+    m_running = m_workers.size();
+    m_generation++;
+
+    m_wakeup.notify_all();
+
+    m_done.wait(lock, [&]{ return m_running == 0; });
+
+    m_requests = nullptr;
+    m_bitmaps = nullptr;
+}
+
+void GlyphRasterizer::releaseFace(FaceID _face) {
+    // Workers are idle when no rasterize() call is in progress
+    std::lock_guard<std::mutex> lock(m_jobMutex);
+
+    for (auto& worker : m_workers) {
+        for (auto it = worker->faces.begin(); it != worker->faces.end();) {
+            if ((it->first >> 32) != _face) {
+                ++it;
+                continue;
+            }
+            if (it->second) { FT_Done_Face(it->second); }
+            it = worker->faces.erase(it);
+        }
+    }
+}
+
+void GlyphRasterizer::faceUnloaded(const FontFace& _face, bool _destroyed) {
+    releaseFace(_face.id());
+
+    if (_destroyed) {
+        std::lock_guard<std::mutex> lock(m_observedMutex);
+        m_observed.erase(&_face);
+    }
+}
+
+void GlyphRasterizer::run(Worker& _worker) {
+    size_t generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeup.wait(lock, [&]{ return m_quit || m_generation != generation; });
+
+            if (m_quit) { return; }
+            generation = m_generation;
+        }
+
+        process(_worker);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_running == 0) { m_done.notify_one(); }
+    }
+}
+
+void GlyphRasterizer::process(Worker& _worker) {
+    auto& requests = *m_requests;
+    auto& bitmaps = *m_bitmaps;
+
+    while (true) {
+        size_t i = m_next.fetch_add(1);
+        if (i >= requests.size()) { return; }
+
+        auto& request = requests[i];
+        FT_Face ftFace = _worker.getFace(*request.face, request.size);
+        if (!ftFace) { continue; }
+
+        if (request.stroke > 0) {
+            request.face->renderGlyph(ftFace, request.codepoint, bitmaps[i],
+                                      request.size, request.stroke);
+            continue;
+        }
+
+        // Color glyphs are always rendered as BGRA bitmaps
+        bool color = request.face->glyphFlags(request.codepoint) & FontFace::GlyphFlag::color;
+
+        if (request.format == GlyphFormat::msdf && !color) {
+            if (request.face->isEmpty(request.codepoint)) {
+                bitmaps[i].empty = true;
+            } else {
+                multiChannelDistanceField(ftFace, request.codepoint, request.spread, bitmaps[i]);
+            }
+            continue;
+        }
+
+        if (!request.face->renderGlyph(ftFace, request.codepoint, bitmaps[i], request.size)) {
+            continue;
+        }
+
+        if (request.format == GlyphFormat::sdf && !color) {
+            GlyphBitmap coverage;
+            std::swap(coverage, bitmaps[i]);
+            distanceField(coverage, request.spread, bitmaps[i]);
+        }
+    }
+}
+
+}
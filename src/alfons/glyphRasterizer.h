@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include "fontFace.h"
+#include "freetypeHelper.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace alfons {
+
+enum class GlyphFormat : uint8_t {
+    coverage,
+    // Signed distance field (see distanceField())
+    sdf,
+    // Multi-channel signed distance field (see multiChannelDistanceField())
+    msdf
+};
+
+struct GlyphRequest {
+    const FontFace* face;
+    hb_codepoint_t codepoint;
+    // Render size in pixels, 0 to use the size of @face
+    float size = 0;
+    GlyphFormat format = GlyphFormat::coverage;
+    // Distance field range in pixels
+    int spread = 0;
+    // Halo width in pixels, renders the stroked outline (coverage only)
+    float stroke = 0;
+
+    GlyphRequest(const FontFace* face, hb_codepoint_t codepoint, float size = 0,
+                 GlyphFormat format = GlyphFormat::coverage, int spread = 0,
+                 float stroke = 0)
+        : face(face), codepoint(codepoint), size(size), format(format), spread(spread),
+          stroke(stroke) {}
+};
+
+/*
+ * Renders glyphs on a pool of worker threads. Each worker has its own
+ * FT_Library and opens its own FT_Face instances of the requested faces,
+ * so no FreeType state is shared between threads.
+ *
+ * With zero workers glyphs are rendered on the calling thread.
+ *
+ * Worker instances of a face are closed when the FontFace is unloaded or
+ * destroyed, which waits for a running rasterize(). rasterize() must be
+ * called from one thread at a time.
+ */
+class GlyphRasterizer : public FaceObserver {
+public:
+    explicit GlyphRasterizer(size_t workers = std::thread::hardware_concurrency());
+
+    ~GlyphRasterizer();
+
+    // Render all @requests - blocks until done. @bitmaps[i] holds the
+    // result for @requests[i], it is invalid when the glyph is empty (see
+    // GlyphBitmap::empty) or could not be rendered. Faces must have been
+    // loaded.
+    void rasterize(const std::vector<GlyphRequest>& requests,
+                   std::vector<GlyphBitmap>& bitmaps);
+
+    // Close all worker instances of @face, they are opened again when
+    // needed. Thread-safe.
+    void releaseFace(FaceID face);
+
+    void faceUnloaded(const FontFace& face, bool destroyed) override;
+
+    size_t workerCount() const { return m_threaded ? m_workers.size() : 0; }
+
+private:
+    struct Worker {
+        std::thread thread;
+        FT_Library library = nullptr;
+        // FT_Face instances by FaceID and size
+        std::unordered_map<uint64_t, FT_Face> faces;
+
+        FT_Face getFace(const FontFace& face, float size);
+    };
+
+    void run(Worker& worker);
+
+    void process(Worker& worker);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    bool m_threaded;
+
+    // Held by rasterize() and releaseFace()
+    std::mutex m_jobMutex;
+
+    // Faces this rasterizer observes. Added to by rasterize() before
+    // m_jobMutex is taken - the lock order is FontFace observers, then
+    // m_jobMutex.
+    std::unordered_set<const FontFace*> m_observed;
+    std::mutex m_observedMutex;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_done;
+
+    // Current job
+    const std::vector<GlyphRequest>* m_requests = nullptr;
+    std::vector<GlyphBitmap>* m_bitmaps = nullptr;
+    std::atomic<size_t> m_next{0};
+    size_t m_running = 0;
+    size_t m_generation = 0;
+
+    bool m_quit = false;
+};
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#include "inkBounds.h"
+#include "font.h"
+
+#include <algorithm>
+
+namespace alfons {
+
+// Add the boxes of shapes [start, end) drawn at @position to @bounds. With
+// @lineBreaks a new line starts after each Shape::mustBreak, as in
+// TextBatch::draw(line, position).
+static bool addRange(const LineLayout& _line, size_t _start, size_t _end, glm::vec2 _position,
+                     bool _lineBreaks, Rect& _bounds, bool _found, float _halo,
+                     std::vector<Rect>* _boxes) {
+
+    auto& font = _line.font();
+    auto& shapes = _line.shapes();
+    float scale = _line.scale();
+
+    // Faces of consecutive shapes are mostly the same
+    const FontFace* face = nullptr;
+
+    float startX = _position.x;
+
+    for (size_t i = _start; i < _end; i++) {
+        auto& shape = shapes[i];
+        glm::vec2 origin = _position + shape.position * scale;
+
+        _position.x += _line.advance(shape);
+        if (_lineBreaks && shape.mustBreak) {
+            _position.x = startX;
+            _position.y += _line.height();
+        }
+
+        if (_boxes) { (*_boxes)[i] = { origin.x, origin.y, origin.x, origin.y }; }
+
+        if (shape.isSpace || shape.isEmpty) { continue; }
+
+        if (!face || face->id() != shape.face) { face = &font.face(shape.face); }
+
+        auto& extents = face->glyphExtents(shape.codepoint);
+        if (extents.size.x <= 0 || extents.size.y <= 0) { continue; }
+
+        glm::vec2 ul = origin + extents.offset * scale;
+        Rect box = { ul.x - _halo, ul.y - _halo,
+                     ul.x + extents.size.x * scale + _halo,
+                     ul.y + extents.size.y * scale + _halo };
+
+        if (_boxes) { (*_boxes)[i] = box; }
+
+        if (!_found) {
+            _bounds = box;
+            _found = true;
+            continue;
+        }
+        _bounds.x1 = std::min(_bounds.x1, box.x1);
+        _bounds.y1 = std::min(_bounds.y1, box.y1);
+        _bounds.x2 = std::max(_bounds.x2, box.x2);
+        _bounds.y2 = std::max(_bounds.y2, box.y2);
+    }
+    return _found;
+}
+
+bool inkBounds(const LineLayout& _line, glm::vec2 _position, Rect& _bounds,
+               float _halo, std::vector<Rect>* _boxes) {
+
+    if (_boxes) { _boxes->resize(_line.shapes().size()); }
+
+    return addRange(_line, 0, _line.shapes().size(), _position, true, _bounds, false,
+                    _halo, _boxes);
+}
+
+bool inkBounds(const LineLayout& _line, const std::vector<LineRange>& _lines,
+               glm::vec2 _position, Rect& _bounds, float _halo, std::vector<Rect>* _boxes) {
+
+    if (_boxes) { _boxes->resize(_line.shapes().size()); }
+
+    bool found = false;
+    for (auto& range : _lines) {
+        found = addRange(_line, range.start, range.end, _position, false, _bounds, found,
+                         _halo, _boxes);
+        _position.y += _line.height();
+    }
+    return found;
+}
+
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include "alfons.h"
+#include "lineLayout.h"
+#include "lineWrap.h"
+
+#include <glm/vec2.hpp>
+
+#include <vector>
+
+namespace alfons {
+
+// Measure glyphs without the atlas, from FontFace::glyphExtents(): Nothing
+// is rasterized, so labels can be tested for collisions before any of their
+// glyphs take atlas space.
+// Boxes are the exact outline extents. Quads drawn by TextBatch enclose them
+// but are slightly larger from bitmap rounding, plus the padding of distance
+// fields.
+
+// Ink box of @line drawn at @position as by TextBatch::draw(), grown by
+// @halo pixels: A new line starts after each Shape::mustBreak. With @boxes, it is resized to line.shapes().size() and
+// receives the box of each shape - empty at the shape origin for shapes
+// without ink. Returns false when no shape has ink.
+bool inkBounds(const LineLayout& line, glm::vec2 position, Rect& bounds,
+               float halo = 0, std::vector<Rect>* boxes = nullptr);
+
+// Like above for @lines from wrap(), one line height apart as drawn by
+// TextBatch::draw(line, lines, position)
+bool inkBounds(const LineLayout& line, const std::vector<LineRange>& lines,
+               glm::vec2 position, Rect& bounds, float halo = 0,
+               std::vector<Rect>* boxes = nullptr);
+
+}
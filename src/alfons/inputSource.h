@@ -49,6 +49,13 @@ public:
 
     bool isSystemFont() const { return m_systemFontName; }
 
+    bool isSameSource(const InputSource& other) const {
+        if (!m_uri.empty() || !other.m_uri.empty()) {
+            return m_uri == other.m_uri && m_systemFontName == other.m_systemFontName;
+        }
+        return m_data == other.m_data;
+    }
+
     bool hasSourceCallback() { return m_data && bool(m_data->loadSource); }
 
     bool resolveSource() {
@@ -16,6 +16,7 @@
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 
+#include <algorithm>
 #include <vector>
 #include <memory>
 
@@ -49,6 +50,8 @@ struct Shape {
             unsigned char noBreak : 1;
 
             unsigned char isSpace : 1;
+            // Glyph has no outline, no need to look it up in the atlas.
+            unsigned char isEmpty : 1;
         };
     };
 
@@ -80,6 +83,41 @@ class LineLayout {
 
     bool m_missingGlyphs = false;
 
+    // Built on first use by rangeAdvance(), fitShapes(), breaks() and
+    // cleared when shapes change. Not thread-safe.
+    struct Index {
+        // Unscaled advance of shapes [0, i)
+        std::vector<float> advances;
+        // End positions (i + 1) of cluster shapes i with canBreak or mustBreak
+        std::vector<uint32_t> breaks;
+        // Like breaks, only mustBreak
+        std::vector<uint32_t> mustBreaks;
+    };
+    mutable Index m_index;
+
+    const Index& index() const {
+        if (m_index.advances.size() == m_shapes.size() + 1) { return m_index; }
+
+        m_index.advances.resize(m_shapes.size() + 1);
+        m_index.breaks.clear();
+        m_index.mustBreaks.clear();
+
+        float sum = 0;
+        m_index.advances[0] = 0;
+        for (size_t i = 0; i < m_shapes.size(); i++) {
+            auto& shape = m_shapes[i];
+            sum += shape.advance;
+            m_index.advances[i + 1] = sum;
+
+            if (!shape.cluster) { continue; }
+            if (shape.canBreak || shape.mustBreak) { m_index.breaks.push_back(i + 1); }
+            if (shape.mustBreak) { m_index.mustBreaks.push_back(i + 1); }
+        }
+        return m_index;
+    }
+
+    void invalidateIndex() { m_index.advances.clear(); }
+
 public:
 
     LineLayout() {}
@@ -107,22 +145,64 @@ public:
             m_advance += shape.advance;
         }
         m_shapes.insert(m_shapes.end(), _shapes.begin(), _shapes.end());
+        invalidateIndex();
     }
 
     void removeShapes(size_t _start, size_t _end) {
-        if (_start > _end || _end > shapes().size()) { return; }
-
-        auto it = m_shapes.begin() + _start;
-        const auto end = m_shapes.begin() + _end;
+        if (_start > _end || _end > m_shapes.size()) { return; }
 
-        for (; it != end; ++it) { m_advance -= it->advance;}
+        auto& advances = index().advances;
+        m_advance -= advances[_end] - advances[_start];
 
-        m_shapes.erase(m_shapes.begin() + _start, end);
+        m_shapes.erase(m_shapes.begin() + _start, m_shapes.begin() + _end);
+        invalidateIndex();
     }
 
-    std::vector<Shape>& shapes() { return m_shapes; }
+    // Shapes may be modified through the returned reference
+    std::vector<Shape>& shapes() {
+        invalidateIndex();
+        return m_shapes;
+    }
     const std::vector<Shape>& shapes() const { return m_shapes; }
 
+    // Advance of shapes [start, end)
+    float rangeAdvance(size_t start, size_t end) const {
+        auto& advances = index().advances;
+        return (advances[end] - advances[start]) * m_scale;
+    }
+
+    // Number of shapes from @start that fit into @width, i.e. the
+    // largest n with rangeAdvance(start, start + n) <= width. Exponential
+    // search from @start, O(log n). Assumes non-negative advances.
+    size_t fitShapes(size_t start, float width) const {
+        auto& advances = index().advances;
+        if (start >= m_shapes.size()) { return 0; }
+
+        float limit = m_scale > 0 ? advances[start] + width / m_scale : advances.back();
+
+        size_t lo = start + 1;
+        size_t step = 1;
+        size_t end = advances.size();
+        while (step < end - lo && advances[lo + step] <= limit) {
+            lo += step;
+            step *= 2;
+        }
+        auto it = std::upper_bound(advances.begin() + lo,
+                                   advances.begin() + std::min(lo + step, end), limit);
+
+        return (it - advances.begin()) - 1 - start;
+    }
+
+    // Unscaled advance of shapes [0, i) at [i], size shapes().size() + 1
+    const std::vector<float>& prefixAdvances() const { return index().advances; }
+
+    // End positions of break opportunities: i + 1 for each cluster shape i
+    // with canBreak or mustBreak, ascending
+    const std::vector<uint32_t>& breaks() const { return index().breaks; }
+
+    // Like breaks(), for mustBreak only
+    const std::vector<uint32_t>& mustBreaks() const { return index().mustBreaks; }
+
     const Font& font() const { return *m_font; }
 
     FontFace::Metrics& metrics() { return m_metrics; }
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#include "lineWrap.h"
+
+#include <algorithm>
+
+namespace alfons {
+
+std::vector<LineRange> wrap(const LineLayout& _line, float _maxWidth) {
+    std::vector<LineRange> lines;
+    wrap(_line, _maxWidth, lines);
+    return lines;
+}
+
+// upper_bound() for values close to @begin
+template <class It, class T>
+static It gallop(It begin, It end, const T& value) {
+    size_t step = 1;
+    while (step < size_t(end - begin) && !(value < begin[step])) {
+        begin += step;
+        step *= 2;
+    }
+    return std::upper_bound(begin, begin + std::min(step, size_t(end - begin)), value);
+}
+
+void wrap(const LineLayout& _line, float _maxWidth, std::vector<LineRange>& _lines) {
+    _lines.clear();
+
+    auto& shapes = _line.shapes();
+    auto& breaks = _line.breaks();
+    auto& mustBreaks = _line.mustBreaks();
+
+    size_t count = shapes.size();
+    size_t start = 0;
+
+    // First break opportunity and mustBreak after start
+    auto first = breaks.begin();
+    auto must = mustBreaks.begin();
+
+    // A line ends at its last break opportunity before the first cluster
+    // that exceeds @maxWidth or at a mustBreak - when it has a break
+    // opportunity at all. Searches start at the current line, so the
+    // cost is logarithmic in the line length.
+    while (start < count && first != breaks.end()) {
+
+        size_t trigger = std::max<size_t>(start + _line.fitShapes(start, _maxWidth), *first - 1);
+        while (trigger < count && !shapes[trigger].cluster) { trigger++; }
+
+        while (must != mustBreaks.end() && *must <= start) { ++must; }
+        if (must != mustBreaks.end()) { trigger = std::min<size_t>(trigger, *must - 1); }
+
+        if (trigger >= count) { break; }
+
+        auto endBreak = gallop(first, breaks.end(), uint32_t(trigger + 1)) - 1;
+        size_t end = *endBreak;
+        size_t last = shapes[end - 1].isSpace ? end - 1 : end;
+
+        _lines.push_back({start, end, _line.rangeAdvance(start, last)});
+
+        start = end;
+        first = endBreak + 1;
+    }
+
+    if (start < count) {
+        size_t last = shapes.back().isSpace ? count - 1 : count;
+        _lines.push_back({start, count, _line.rangeAdvance(start, last)});
+    }
+}
+
+void wrapTrials(const LineLayout& _line, const std::vector<float>& _widths,
+                std::vector<WrapTrial>& _trials) {
+
+    _trials.resize(_widths.size());
+
+    // Runs wrap() once per width. The break index of @line is shared by
+    // all runs, each only visits the break opportunities around its line
+    // ends.
+    for (size_t k = 0; k < _widths.size(); k++) {
+        auto& trial = _trials[k];
+        trial.maxWidth = _widths[k];
+        wrap(_line, _widths[k], trial.lines);
+        trial.size = wrappedSize(_line, trial.lines);
+    }
+}
+
+glm::vec2 wrappedSize(const LineLayout& _line, const std::vector<LineRange>& _lines) {
+    float width = 0;
+    for (auto& line : _lines) { width = std::max(width, line.advance); }
+
+    return { width, _lines.size() * _line.height() };
+}
+
+}
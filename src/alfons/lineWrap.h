@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include "lineLayout.h"
+
+#include <glm/vec2.hpp>
+
+#include <vector>
+
+namespace alfons {
+
+struct LineRange {
+    // Shapes [start, end) of the line, including a trailing space
+    size_t start;
+    size_t end;
+    // Advance of the line without trailing space
+    float advance;
+};
+
+// Break @line into lines of at most @maxWidth advance at the break
+// opportunities of its shapes (Shape::canBreak, Shape::mustBreak) - as
+// drawn by TextBatch::draw(line, position, width). Words wider than
+// @maxWidth get a line of their own. Only reads shape advances, so the
+// result can be kept until the shapes or the scale of @line change.
+std::vector<LineRange> wrap(const LineLayout& line, float maxWidth);
+
+// Like above, writes into @lines to reuse its storage
+void wrap(const LineLayout& line, float maxWidth, std::vector<LineRange>& lines);
+
+struct WrapTrial {
+    float maxWidth;
+    std::vector<LineRange> lines;
+    // wrappedSize() of lines
+    glm::vec2 size;
+};
+
+// Wrap @line at each of @widths, e.g. to pick the candidate with the best
+// aspect ratio. The shapes are indexed once (see LineLayout::breaks()),
+// each trial costs O(lines * log(line length)). Results are the same as
+// from wrap() for each width. Reuses the storage of @trials.
+void wrapTrials(const LineLayout& line, const std::vector<float>& widths,
+                std::vector<WrapTrial>& trials);
+
+// Width of the widest line and height of all @lines
+glm::vec2 wrappedSize(const LineLayout& line, const std::vector<LineRange>& lines);
+
+}
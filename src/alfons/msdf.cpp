@@ -0,0 +1,718 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#include "msdf.h"
+#include "alfons.h"
+
+#include FT_OUTLINE_H
+
+#include <glm/vec2.hpp>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(ALFONS_SSE2)
+#include <emmintrin.h>
+#define ALFONS_MSDF_LANES
+#elif defined(ALFONS_NEON) && defined(__aarch64__)
+// Needs vdivq_f32 and vsqrtq_f32
+#include <arm_neon.h>
+#define ALFONS_MSDF_LANES
+#endif
+
+namespace alfons {
+
+using glm::vec2;
+
+enum EdgeColor : uint8_t {
+    BLACK = 0,
+    RED = 1,
+    GREEN = 2,
+    YELLOW = 3,
+    BLUE = 4,
+    MAGENTA = 5,
+    CYAN = 6,
+    WHITE = 7
+};
+
+// Outline flattened into line segments, stored SoA for the distance loop
+struct Segments {
+    std::vector<float> ax, ay, bx, by;
+    std::vector<uint8_t> color;
+    // Index of first segment for each contour, plus end
+    std::vector<size_t> contours;
+
+    size_t size() const { return ax.size(); }
+
+    void add(vec2 a, vec2 b) {
+        if (a == b) { return; }
+        ax.push_back(a.x);
+        ay.push_back(a.y);
+        bx.push_back(b.x);
+        by.push_back(b.y);
+        color.push_back(WHITE);
+    }
+
+    vec2 dir(size_t i) const {
+        return glm::normalize(vec2(bx[i] - ax[i], by[i] - ay[i]));
+    }
+};
+
+struct Decomposer {
+    Segments& segments;
+    vec2 pos;
+
+    static vec2 point(const FT_Vector* v) { return vec2(v->x / 64.f, v->y / 64.f); }
+
+    static float turn(vec2 a, vec2 b, vec2 c) {
+        vec2 u = b - a, v = c - b;
+        return std::fabs(std::atan2(u.x * v.y - u.y * v.x, glm::dot(u, v)));
+    }
+
+    // Pieces so that the tangent turns well below the corner threshold
+    // between pieces and the curve is followed closely
+    static int pieces(float angle, float length) {
+        int n = std::max(std::ceil(angle / 0.05f), std::ceil(length / 4.f));
+        return std::max(1, std::min(64, n));
+    }
+
+    static int moveTo(const FT_Vector* to, void* user) {
+        auto& d = *static_cast<Decomposer*>(user);
+        d.segments.contours.push_back(d.segments.size());
+        d.pos = point(to);
+        return 0;
+    }
+
+    static int lineTo(const FT_Vector* to, void* user) {
+        auto& d = *static_cast<Decomposer*>(user);
+        vec2 p = point(to);
+        d.segments.add(d.pos, p);
+        d.pos = p;
+        return 0;
+    }
+
+    static int conicTo(const FT_Vector* control, const FT_Vector* to, void* user) {
+        auto& d = *static_cast<Decomposer*>(user);
+        vec2 p0 = d.pos, p1 = point(control), p2 = point(to);
+
+        int n = pieces(turn(p0, p1, p2), glm::length(p1 - p0) + glm::length(p2 - p1));
+        vec2 prev = p0;
+        for (int i = 1; i <= n; i++) {
+            float t = float(i) / n, s = 1 - t;
+            vec2 p = p0 * (s * s) + p1 * (2 * s * t) + p2 * (t * t);
+            d.segments.add(prev, p);
+            prev = p;
+        }
+        d.pos = p2;
+        return 0;
+    }
+
+    static int cubicTo(const FT_Vector* control1, const FT_Vector* control2,
+                       const FT_Vector* to, void* user) {
+        auto& d = *static_cast<Decomposer*>(user);
+        vec2 p0 = d.pos, p1 = point(control1), p2 = point(control2), p3 = point(to);
+
+        int n = pieces(turn(p0, p1, p2) + turn(p1, p2, p3),
+                       glm::length(p1 - p0) + glm::length(p2 - p1) + glm::length(p3 - p2));
+        vec2 prev = p0;
+        for (int i = 1; i <= n; i++) {
+            float t = float(i) / n, s = 1 - t;
+            vec2 p = p0 * (s * s * s) + p1 * (3 * s * s * t) +
+                p2 * (3 * s * t * t) + p3 * (t * t * t);
+            d.segments.add(prev, p);
+            prev = p;
+        }
+        d.pos = p3;
+        return 0;
+    }
+};
+
+static float cross(vec2 a, vec2 b) { return a.x * b.y - a.y * b.x; }
+
+static void switchColor(uint8_t& color, uint8_t banned = BLACK) {
+    uint8_t combined = color & banned;
+    if (combined == RED || combined == GREEN || combined == BLUE) {
+        color = combined ^ WHITE;
+        return;
+    }
+    if (color == BLACK || color == WHITE) {
+        color = CYAN;
+        return;
+    }
+    int shifted = color << 1;
+    color = (shifted | shifted >> 3) & WHITE;
+}
+
+// Assign colors so that channels change at corners (msdfgen 'simple' coloring)
+static void colorEdges(Segments& segments) {
+    // sin of the maximal angle between segments that is not a corner
+    const float crossThreshold = std::sin(3.0f);
+
+    for (size_t c = 0; c + 1 < segments.contours.size(); c++) {
+        size_t begin = segments.contours[c];
+        size_t end = segments.contours[c + 1];
+        size_t count = end - begin;
+        if (count == 0) { continue; }
+
+        std::vector<size_t> corners;
+        vec2 prevDir = segments.dir(end - 1);
+        for (size_t i = 0; i < count; i++) {
+            vec2 dir = segments.dir(begin + i);
+            if (glm::dot(prevDir, dir) <= 0 || std::fabs(cross(prevDir, dir)) > crossThreshold) {
+                corners.push_back(i);
+            }
+            prevDir = dir;
+        }
+
+        if (corners.empty()) {
+            // Smooth contour
+            continue;
+        }
+
+        if (corners.size() == 1) {
+            // Teardrop: Split in three parts around the corner
+            uint8_t colors[3] = { WHITE, WHITE, BLACK };
+            switchColor(colors[0]);
+            colors[2] = colors[0];
+            switchColor(colors[2]);
+
+            size_t corner = corners[0];
+            for (size_t i = 0; i < count; i++) {
+                int part = count < 3 ? int(i) : int(3 + 2.875f * i / (count - 1) - 1.4375f + .5f) - 3;
+                part = std::max(-1, std::min(1, part));
+                segments.color[begin + (corner + i) % count] = colors[1 + part];
+            }
+            continue;
+        }
+
+        size_t spline = 0;
+        size_t start = corners[0];
+        uint8_t color = WHITE;
+        switchColor(color);
+        uint8_t initialColor = color;
+
+        for (size_t i = 0; i < count; i++) {
+            size_t index = (start + i) % count;
+            if (spline + 1 < corners.size() && corners[spline + 1] == index) {
+                spline++;
+                switchColor(color, (spline == corners.size() - 1) ? initialColor : uint8_t(BLACK));
+            }
+            segments.color[begin + index] = color;
+        }
+    }
+}
+
+struct SignedDistance {
+    float distance = 1e20f;
+    float dot = 1;
+
+    bool operator<(const SignedDistance& o) const {
+        float a = std::fabs(distance), b = std::fabs(o.distance);
+        return a < b || (a == b && dot < o.dot);
+    }
+};
+
+#if !defined(ALFONS_MSDF_LANES)
+static SignedDistance segmentDistance(const Segments& s, size_t i, vec2 p, float& param) {
+    vec2 a(s.ax[i], s.ay[i]);
+    vec2 ab = vec2(s.bx[i], s.by[i]) - a;
+    vec2 aq = p - a;
+
+    float len2 = glm::dot(ab, ab);
+    param = glm::dot(aq, ab) / len2;
+
+    vec2 eq = (param > .5f ? vec2(s.bx[i], s.by[i]) : a) - p;
+    float endpointDistance = glm::length(eq);
+
+    SignedDistance d;
+    if (param > 0 && param < 1) {
+        float orthoDistance = cross(aq, ab) / std::sqrt(len2);
+        if (std::fabs(orthoDistance) < endpointDistance) {
+            d.distance = orthoDistance;
+            d.dot = 0;
+            return d;
+        }
+    }
+    float c = cross(aq, ab);
+    d.distance = (c >= 0 ? 1.f : -1.f) * endpointDistance;
+    d.dot = endpointDistance > 0
+        ? std::fabs(glm::dot(ab, eq)) / (std::sqrt(len2) * endpointDistance) : 0;
+    return d;
+}
+#else
+// Segments in SoA layout, for distances to 4 of them at a time
+struct Lanes {
+    std::vector<float> ax, ay, bx, by, abx, aby, len2, len;
+    std::vector<uint32_t> segment;
+
+    size_t size() const { return segment.size(); }
+
+    // Segments of @candidates, padded to a multiple of 4 with copies of
+    // the last one: Copies never replace an equal distance.
+    template <class Candidate>
+    void pack(const Segments& s, const std::vector<Candidate>& candidates) {
+        size_t n = (candidates.size() + 3) & ~size_t(3);
+        for (auto* v : { &ax, &ay, &bx, &by, &abx, &aby, &len2, &len }) { v->resize(n); }
+        segment.resize(n);
+
+        for (size_t k = 0; k < n; k++) {
+            uint32_t i = candidates[std::min(k, candidates.size() - 1)].segment;
+            segment[k] = i;
+            ax[k] = s.ax[i];
+            ay[k] = s.ay[i];
+            bx[k] = s.bx[i];
+            by[k] = s.by[i];
+            abx[k] = s.bx[i] - s.ax[i];
+            aby[k] = s.by[i] - s.ay[i];
+            len2[k] = abx[k] * abx[k] + aby[k] * aby[k];
+            len[k] = std::sqrt(len2[k]);
+        }
+    }
+};
+
+// Signed distance of all segments of @l to @p, with the operations of
+// segmentDistance() per lane
+static void laneDistances(const Lanes& l, vec2 p, float* distance, float* dot, float* param) {
+#if defined(ALFONS_SSE2)
+    const __m128 px = _mm_set1_ps(p.x), py = _mm_set1_ps(p.y);
+    const __m128 zero = _mm_setzero_ps(), half = _mm_set1_ps(.5f), one = _mm_set1_ps(1.f);
+    const __m128 signBit = _mm_set1_ps(-0.f);
+
+    auto select = [](__m128 mask, __m128 a, __m128 b) {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    };
+
+    for (size_t k = 0; k < l.size(); k += 4) {
+        __m128 ax = _mm_loadu_ps(&l.ax[k]), ay = _mm_loadu_ps(&l.ay[k]);
+        __m128 abx = _mm_loadu_ps(&l.abx[k]), aby = _mm_loadu_ps(&l.aby[k]);
+        __m128 len = _mm_loadu_ps(&l.len[k]);
+
+        __m128 aqx = _mm_sub_ps(px, ax), aqy = _mm_sub_ps(py, ay);
+        __m128 t = _mm_div_ps(_mm_add_ps(_mm_mul_ps(aqx, abx), _mm_mul_ps(aqy, aby)),
+                              _mm_loadu_ps(&l.len2[k]));
+
+        __m128 far = _mm_cmpgt_ps(t, half);
+        __m128 ex = _mm_sub_ps(select(far, _mm_loadu_ps(&l.bx[k]), ax), px);
+        __m128 ey = _mm_sub_ps(select(far, _mm_loadu_ps(&l.by[k]), ay), py);
+        __m128 end = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)));
+
+        __m128 c = _mm_sub_ps(_mm_mul_ps(aqx, aby), _mm_mul_ps(aqy, abx));
+        __m128 ortho = _mm_div_ps(c, len);
+        __m128 useOrtho = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, one)),
+                                     _mm_cmplt_ps(_mm_andnot_ps(signBit, ortho), end));
+
+        __m128 signedEnd = _mm_or_ps(end, _mm_and_ps(_mm_cmplt_ps(c, zero), signBit));
+        __m128 endDot = _mm_div_ps(
+            _mm_andnot_ps(signBit, _mm_add_ps(_mm_mul_ps(abx, ex), _mm_mul_ps(aby, ey))),
+            _mm_mul_ps(len, end));
+        endDot = _mm_and_ps(_mm_cmpgt_ps(end, zero), endDot);
+
+        _mm_storeu_ps(&distance[k], select(useOrtho, ortho, signedEnd));
+        _mm_storeu_ps(&dot[k], _mm_andnot_ps(useOrtho, endDot));
+        _mm_storeu_ps(&param[k], t);
+    }
+#else
+    const float32x4_t px = vdupq_n_f32(p.x), py = vdupq_n_f32(p.y);
+    const float32x4_t zero = vdupq_n_f32(0.f), half = vdupq_n_f32(.5f), one = vdupq_n_f32(1.f);
+
+    for (size_t k = 0; k < l.size(); k += 4) {
+        float32x4_t ax = vld1q_f32(&l.ax[k]), ay = vld1q_f32(&l.ay[k]);
+        float32x4_t abx = vld1q_f32(&l.abx[k]), aby = vld1q_f32(&l.aby[k]);
+        float32x4_t len = vld1q_f32(&l.len[k]);
+
+        float32x4_t aqx = vsubq_f32(px, ax), aqy = vsubq_f32(py, ay);
+        float32x4_t t = vdivq_f32(vaddq_f32(vmulq_f32(aqx, abx), vmulq_f32(aqy, aby)),
+                                  vld1q_f32(&l.len2[k]));
+
+        uint32x4_t far = vcgtq_f32(t, half);
+        float32x4_t ex = vsubq_f32(vbslq_f32(far, vld1q_f32(&l.bx[k]), ax), px);
+        float32x4_t ey = vsubq_f32(vbslq_f32(far, vld1q_f32(&l.by[k]), ay), py);
+        float32x4_t end = vsqrtq_f32(vaddq_f32(vmulq_f32(ex, ex), vmulq_f32(ey, ey)));
+
+        float32x4_t c = vsubq_f32(vmulq_f32(aqx, aby), vmulq_f32(aqy, abx));
+        float32x4_t ortho = vdivq_f32(c, len);
+        uint32x4_t useOrtho = vandq_u32(vandq_u32(vcgtq_f32(t, zero), vcltq_f32(t, one)),
+                                        vcltq_f32(vabsq_f32(ortho), end));
+
+        float32x4_t signedEnd = vbslq_f32(vcltq_f32(c, zero), vnegq_f32(end), end);
+        float32x4_t endDot = vdivq_f32(vabsq_f32(vaddq_f32(vmulq_f32(abx, ex), vmulq_f32(aby, ey))),
+                                       vmulq_f32(len, end));
+        endDot = vbslq_f32(vcgtq_f32(end, zero), endDot, zero);
+
+        vst1q_f32(&distance[k], vbslq_f32(useOrtho, ortho, signedEnd));
+        vst1q_f32(&dot[k], vbslq_f32(useOrtho, zero, endDot));
+        vst1q_f32(&param[k], t);
+    }
+#endif
+}
+#endif
+
+// Extend the segment beyond its endpoints to keep corners sharp
+static float pseudoDistance(const Segments& s, size_t i, vec2 p, SignedDistance d, float param) {
+    vec2 a(s.ax[i], s.ay[i]);
+    vec2 b(s.bx[i], s.by[i]);
+    vec2 dir = glm::normalize(b - a);
+
+    if (param < 0) {
+        vec2 aq = p - a;
+        if (glm::dot(aq, dir) < 0) {
+            float pd = cross(aq, dir);
+            if (std::fabs(pd) <= std::fabs(d.distance)) { return pd; }
+        }
+    } else if (param > 1) {
+        vec2 bq = p - b;
+        if (glm::dot(bq, dir) > 0) {
+            float pd = cross(bq, dir);
+            if (std::fabs(pd) <= std::fabs(d.distance)) { return pd; }
+        }
+    }
+    return d.distance;
+}
+
+static float median(float a, float b, float c) {
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+bool multiChannelDistanceField(FT_Face _ftFace, FT_UInt _glyph, int _spread, GlyphBitmap& _out) {
+    _out.buffer.clear();
+    _out.empty = false;
+
+    if (_glyph == 0) { return false; }
+
+    if (FT_Load_Glyph(_ftFace, _glyph, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING) != 0) {
+        return false;
+    }
+    auto* slot = _ftFace->glyph;
+    if (slot->format != FT_GLYPH_FORMAT_OUTLINE) { return false; }
+
+    return multiChannelDistanceField(slot->outline, _spread, _out);
+}
+
+bool multiChannelDistanceField(FT_Outline& _outline, int _spread, GlyphBitmap& _out) {
+    _spread = std::max(_spread, 1);
+
+    _out.buffer.clear();
+    _out.empty = false;
+
+    if (_outline.n_contours == 0) {
+        _out.empty = true;
+        return false;
+    }
+
+    Segments segments;
+    Decomposer decomposer{segments, vec2(0, 0)};
+
+    FT_Outline_Funcs funcs;
+    funcs.move_to = &Decomposer::moveTo;
+    funcs.line_to = &Decomposer::lineTo;
+    funcs.conic_to = &Decomposer::conicTo;
+    funcs.cubic_to = &Decomposer::cubicTo;
+    funcs.shift = 0;
+    funcs.delta = 0;
+
+    if (FT_Outline_Decompose(&_outline, &funcs, &decomposer) != 0) { return false; }
+
+    // Close contours
+    for (size_t c = 0; c < segments.contours.size(); c++) {
+        size_t begin = segments.contours[c];
+        size_t end = c + 1 < segments.contours.size() ? segments.contours[c + 1] : segments.size();
+        if (begin == end) { continue; }
+
+        vec2 first(segments.ax[begin], segments.ay[begin]);
+        vec2 last(segments.bx[end - 1], segments.by[end - 1]);
+        if (first != last) {
+            segments.add(last, first);
+            // Move new segment to end of its contour
+            for (size_t k = c + 1; k < segments.contours.size(); k++) { segments.contours[k]++; }
+            std::rotate(segments.ax.begin() + end, segments.ax.end() - 1, segments.ax.end());
+            std::rotate(segments.ay.begin() + end, segments.ay.end() - 1, segments.ay.end());
+            std::rotate(segments.bx.begin() + end, segments.bx.end() - 1, segments.bx.end());
+            std::rotate(segments.by.begin() + end, segments.by.end() - 1, segments.by.end());
+        }
+    }
+    segments.contours.push_back(segments.size());
+
+    if (segments.size() == 0) {
+        _out.empty = true;
+        return false;
+    }
+
+    colorEdges(segments);
+
+    // Inside should be positive: TrueType outer contours are clockwise
+    float orientation = FT_Outline_Get_Orientation(&_outline) == FT_ORIENTATION_TRUETYPE
+        ? 1.f : -1.f;
+
+    FT_BBox box;
+    FT_Outline_Get_CBox(&_outline, &box);
+
+    int left = int(std::floor(box.xMin / 64.f)) - _spread;
+    int right = int(std::ceil(box.xMax / 64.f)) + _spread;
+    int bottom = int(std::floor(box.yMin / 64.f)) - _spread;
+    int top = int(std::ceil(box.yMax / 64.f)) + _spread;
+
+    int w = right - left;
+    int h = top - bottom;
+
+    _out.x0 = left;
+    _out.x1 = right;
+    _out.y0 = -top;
+    _out.y1 = -bottom;
+    _out.channels = 3;
+    _out.buffer.resize(w * h * 3);
+
+    float scale = 127.f / _spread;
+    auto encode = [&](float d) -> unsigned char {
+        return std::max(0.f, std::min(255.f, std::round(128.f + d * orientation * scale)));
+    };
+
+    const uint8_t channels[3] = { RED, GREEN, BLUE };
+    const size_t count = segments.size();
+
+    // Nonzero winding of pixel centers, per row from the crossings of the
+    // outline with the scanline
+    std::vector<uint8_t> inside(w * h);
+    std::vector<std::pair<float, int>> crossings;
+
+    for (int row = 0; row < h; row++) {
+        float y = top - row - .5f;
+
+        crossings.clear();
+        for (size_t i = 0; i < count; i++) {
+            float ay = segments.ay[i], by = segments.by[i];
+            int dir = (ay <= y && by > y) ? 1 : (by <= y && ay > y) ? -1 : 0;
+            if (dir == 0) { continue; }
+
+            float t = (y - ay) / (by - ay);
+            crossings.emplace_back(segments.ax[i] + t * (segments.bx[i] - segments.ax[i]), dir);
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        // Winding counts the crossings right of the pixel
+        int winding = 0;
+        for (auto& c : crossings) { winding += c.second; }
+
+        size_t next = 0;
+        for (int col = 0; col < w; col++) {
+            float x = left + col + .5f;
+            while (next < crossings.size() && crossings[next].first <= x) {
+                winding -= crossings[next++].second;
+            }
+            inside[row * w + col] = winding != 0;
+        }
+    }
+
+    // Distances are computed per tile only to the segments that can be
+    // nearest to one of its pixels in any channel. With D the distance of
+    // a segment to the tile center and r the radius of the tile, pixels
+    // are at least D - r and at most D + r away from it: A segment is
+    // skipped when D - r exceeds D + r of the nearest segment of each of
+    // its channels. Tiles are culled from the candidates of their block.
+    // With SSE2 or NEON distances to the tile center and to pixels are
+    // computed for 4 candidates at a time (see laneDistances()).
+    struct Candidate {
+        uint32_t segment;
+        // Lower bound of the distance to the pixels of the tile
+        float distance;
+    };
+    struct Candidates {
+        std::vector<Candidate> list;
+#if defined(ALFONS_MSDF_LANES)
+        // Segments of list, for laneDistances()
+        Lanes lanes;
+#endif
+    };
+    std::vector<float> centerDistance(count);
+
+#if defined(ALFONS_MSDF_LANES)
+    // Results of laneDistances()
+    size_t maxLanes = (count + 3) & ~size_t(3);
+    std::vector<float> laneDistance(maxLanes), laneDot(maxLanes), laneParam(maxLanes);
+#endif
+
+    std::vector<float> minX(count), maxX(count), minY(count), maxY(count);
+    for (size_t i = 0; i < count; i++) {
+        minX[i] = std::min(segments.ax[i], segments.bx[i]);
+        maxX[i] = std::max(segments.ax[i], segments.bx[i]);
+        minY[i] = std::min(segments.ay[i], segments.by[i]);
+        maxY[i] = std::max(segments.ay[i], segments.by[i]);
+    }
+
+    // Upper bound of the distance to the nearest segment of each channel
+    // for pixels of the current tile
+    float bound[3];
+
+    auto cull = [&](float x0, float x1, float y0, float y1,
+                    const Candidates& from, Candidates& to) {
+
+        vec2 center((x0 + x1) * .5f, (y0 + y1) * .5f);
+        float radius = glm::length(vec2(x1 - x0, y1 - y0)) * .5f;
+
+#if defined(ALFONS_MSDF_LANES)
+        laneDistances(from.lanes, center, laneDistance.data(), laneDot.data(), laneParam.data());
+#endif
+
+        bound[0] = bound[1] = bound[2] = 1e20f;
+        for (size_t k = 0; k < from.list.size(); k++) {
+            uint32_t i = from.list[k].segment;
+#if defined(ALFONS_MSDF_LANES)
+            float d = std::fabs(laneDistance[k]);
+#else
+            vec2 a(segments.ax[i], segments.ay[i]);
+            vec2 ab = vec2(segments.bx[i], segments.by[i]) - a;
+            float t = std::max(0.f, std::min(1.f, glm::dot(center - a, ab) / glm::dot(ab, ab)));
+            float d = glm::length(a + ab * t - center);
+#endif
+            centerDistance[i] = d;
+
+            for (int ch = 0; ch < 3; ch++) {
+                if (segments.color[i] & channels[ch]) { bound[ch] = std::min(bound[ch], d + radius); }
+            }
+        }
+
+        to.list.clear();
+        for (auto& c : from.list) {
+            uint32_t i = c.segment;
+            float limit = 0;
+            for (int ch = 0; ch < 3; ch++) {
+                if (segments.color[i] & channels[ch]) { limit = std::max(limit, bound[ch]); }
+            }
+            // Margin for rounding, ties must be kept
+            float lower = centerDistance[i] - radius - 1e-3f;
+            if (lower <= limit) { to.list.push_back({ i, lower }); }
+        }
+#if defined(ALFONS_MSDF_LANES)
+        to.lanes.pack(segments, to.list);
+#endif
+    };
+
+    // Distance of the pixel at @row, @col to the nearest of @candidates
+    auto shade = [&](int row, int col, const Candidates& candidates) {
+        vec2 p(left + col + .5f, top - row - .5f);
+
+        SignedDistance best[3];
+        size_t bestSegment[3] = { 0, 0, 0 };
+        float bestParam[3] = { 0, 0, 0 };
+        SignedDistance minDistance;
+
+#if defined(ALFONS_MSDF_LANES)
+        // Distances to all candidates of the tile 4 at a time, then pick
+        // the nearest in order as below
+        auto& lanes = candidates.lanes;
+        laneDistances(lanes, p, laneDistance.data(), laneDot.data(), laneParam.data());
+
+        for (size_t k = 0; k < lanes.size(); k++) {
+            uint32_t i = lanes.segment[k];
+
+            SignedDistance d;
+            d.distance = laneDistance[k];
+            d.dot = laneDot[k];
+
+            if (d < minDistance) { minDistance = d; }
+
+            for (int ch = 0; ch < 3; ch++) {
+                if ((segments.color[i] & channels[ch]) && d < best[ch]) {
+                    best[ch] = d;
+                    bestSegment[ch] = i;
+                    bestParam[ch] = laneParam[k];
+                }
+            }
+        }
+#else
+        for (auto& c : candidates.list) {
+            uint32_t i = c.segment;
+
+            // Skip segments farther than the nearest ones of their channels
+            float limit = 0;
+            for (int ch = 0; ch < 3; ch++) {
+                if (segments.color[i] & channels[ch]) {
+                    limit = std::max(limit, std::min(bound[ch], std::fabs(best[ch].distance)));
+                }
+            }
+            if (c.distance > limit) { continue; }
+
+            float dx = std::max(0.f, std::max(minX[i] - p.x, p.x - maxX[i]));
+            float dy = std::max(0.f, std::max(minY[i] - p.y, p.y - maxY[i]));
+            if (dx * dx + dy * dy > limit * limit * 1.001f + 1e-3f) { continue; }
+
+            float param;
+            SignedDistance d = segmentDistance(segments, i, p, param);
+
+            if (d < minDistance) { minDistance = d; }
+
+            for (int ch = 0; ch < 3; ch++) {
+                if ((segments.color[i] & channels[ch]) && d < best[ch]) {
+                    best[ch] = d;
+                    bestSegment[ch] = i;
+                    bestParam[ch] = param;
+                }
+            }
+        }
+#endif
+
+        float value[3];
+        for (int ch = 0; ch < 3; ch++) {
+            value[ch] = pseudoDistance(segments, bestSegment[ch], p, best[ch], bestParam[ch]);
+        }
+
+        // Fall back to the true distance where the channels disagree
+        // with the actual inside/outside state
+        bool in = inside[row * w + col];
+        float m = median(value[0], value[1], value[2]) * orientation;
+        if ((m > 0) != in) {
+            float d = std::fabs(minDistance.distance) * (in ? 1.f : -1.f) * orientation;
+            value[0] = value[1] = value[2] = d;
+        }
+
+        unsigned char* dst = &_out.buffer[(row * w + col) * 3];
+        dst[0] = encode(value[0]);
+        dst[1] = encode(value[1]);
+        dst[2] = encode(value[2]);
+    };
+
+    const int blockSize = 16;
+    const int tileSize = 4;
+
+    Candidates all;
+    all.list.resize(count);
+    for (size_t i = 0; i < count; i++) { all.list[i] = { uint32_t(i), 0 }; }
+#if defined(ALFONS_MSDF_LANES)
+    all.lanes.pack(segments, all.list);
+#endif
+
+    Candidates blockCandidates;
+    Candidates candidates;
+
+    for (int by = 0; by < h; by += blockSize) {
+        for (int bx = 0; bx < w; bx += blockSize) {
+            int bw = std::min(blockSize, w - bx);
+            int bh = std::min(blockSize, h - by);
+
+            cull(left + bx + .5f, left + bx + bw - .5f,
+                 top - by - bh + .5f, top - by - .5f, all, blockCandidates);
+
+            for (int ty = by; ty < by + bh; ty += tileSize) {
+                for (int tx = bx; tx < bx + bw; tx += tileSize) {
+                    int tw = std::min(tileSize, bx + bw - tx);
+                    int th = std::min(tileSize, by + bh - ty);
+
+                    cull(left + tx + .5f, left + tx + tw - .5f,
+                         top - ty - th + .5f, top - ty - .5f, blockCandidates, candidates);
+
+                    for (int row = ty; row < ty + th; row++) {
+                        for (int col = tx; col < tx + tw; col++) { shade(row, col, candidates); }
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include "freetypeHelper.h"
+
+namespace alfons {
+
+/*
+ * Render a multi-channel signed distance field (after Chlumsky's msdfgen)
+ * for @glyph from the outline of @ftFace at its current size.
+ *
+ * The outline is decomposed into line segments (curves are flattened), and
+ * edges between corners are colored such that at each corner two of the
+ * three channels change. The median of the channels then reconstructs
+ * sharp corners at any magnification.
+ *
+ * @out gets 3 bytes (RGB) per pixel and is @spread pixels larger than the
+ * outline bounds on each side. Distances are mapped like distanceField(),
+ * a @spread below 1 is taken as 1.
+ */
+bool multiChannelDistanceField(FT_Face ftFace, FT_UInt glyph, int spread, GlyphBitmap& out);
+
+// Field of @outline in 26.6 coordinates. Sets GlyphBitmap::empty for
+// outlines without contours.
+bool multiChannelDistanceField(FT_Outline& outline, int spread, GlyphBitmap& out);
+
+}
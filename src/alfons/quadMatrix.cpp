@@ -14,6 +14,13 @@
 #include "glm/gtx/transform.hpp"
 
 #include <cmath>
+#include <cstring>
+
+#if defined(ALFONS_SSE2)
+#include <emmintrin.h>
+#elif defined(ALFONS_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace alfons {
 
@@ -164,4 +171,202 @@ void QuadMatrix::transformRect(const Rect& _rect, Quad& out) const {
     out.x4 = x200 + y101 + m03;
     out.y4 = x210 + y111 + m13;
 }
+
+void QuadMatrix::transformRects(const RectBatch& _rects, Quad* _out) const {
+    transformBatch(_rects, nullptr, _out, nullptr);
+}
+
+size_t QuadMatrix::transformRects(const RectBatch& _rects, const Rect& _clip, Quad* _out,
+                                  uint32_t* _indices) const {
+    return transformBatch(_rects, &_clip, _out, _indices);
+}
+
+size_t QuadMatrix::transformBatch(const RectBatch& _rects, const Rect* _clip, Quad* _out,
+                                  uint32_t* _indices) const {
+
+    size_t count = _rects.size();
+    bool placed = _rects.hasPlacement();
+    size_t kept = 0;
+    size_t i = 0;
+
+    // Four rects per iteration. Corners in the order of transformRect():
+    // (x1, y1), (x1, y2), (x2, y2), (x2, y1)
+#if defined(ALFONS_SSE2)
+    const __m128 a00 = _mm_set1_ps(m00), a01 = _mm_set1_ps(m01), a03 = _mm_set1_ps(m03);
+    const __m128 a10 = _mm_set1_ps(m10), a11 = _mm_set1_ps(m11), a13 = _mm_set1_ps(m13);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 x1 = _mm_loadu_ps(&_rects.x1[i]);
+        __m128 y1 = _mm_loadu_ps(&_rects.y1[i]);
+        __m128 x2 = _mm_loadu_ps(&_rects.x2[i]);
+        __m128 y2 = _mm_loadu_ps(&_rects.y2[i]);
+
+        __m128 cx[4] = { x1, x1, x2, x2 };
+        __m128 cy[4] = { y1, y2, y2, y1 };
+
+        if (placed) {
+            __m128 c = _mm_loadu_ps(&_rects.c[i]);
+            __m128 s = _mm_loadu_ps(&_rects.s[i]);
+            __m128 tx = _mm_loadu_ps(&_rects.tx[i]);
+            __m128 ty = _mm_loadu_ps(&_rects.ty[i]);
+
+            for (int k = 0; k < 4; k++) {
+                __m128 x = cx[k];
+                cx[k] = _mm_add_ps(tx, _mm_sub_ps(_mm_mul_ps(c, x), _mm_mul_ps(s, cy[k])));
+                cy[k] = _mm_add_ps(ty, _mm_add_ps(_mm_mul_ps(s, x), _mm_mul_ps(c, cy[k])));
+            }
+        }
+
+        __m128 ox[4], oy[4];
+        for (int k = 0; k < 4; k++) {
+            ox[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx[k], a00), _mm_mul_ps(cy[k], a01)), a03);
+            oy[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx[k], a10), _mm_mul_ps(cy[k], a11)), a13);
+        }
+
+        int keep = 0xf;
+        if (_clip) {
+            __m128 minX = _mm_min_ps(_mm_min_ps(ox[0], ox[1]), _mm_min_ps(ox[2], ox[3]));
+            __m128 maxX = _mm_max_ps(_mm_max_ps(ox[0], ox[1]), _mm_max_ps(ox[2], ox[3]));
+            __m128 minY = _mm_min_ps(_mm_min_ps(oy[0], oy[1]), _mm_min_ps(oy[2], oy[3]));
+            __m128 maxY = _mm_max_ps(_mm_max_ps(oy[0], oy[1]), _mm_max_ps(oy[2], oy[3]));
+
+            __m128 outside = _mm_or_ps(
+                _mm_or_ps(_mm_cmpgt_ps(minX, _mm_set1_ps(_clip->x2)),
+                          _mm_cmpgt_ps(minY, _mm_set1_ps(_clip->y2))),
+                _mm_or_ps(_mm_cmplt_ps(maxX, _mm_set1_ps(_clip->x1)),
+                          _mm_cmplt_ps(maxY, _mm_set1_ps(_clip->y1))));
+
+            keep = ~_mm_movemask_ps(outside) & 0xf;
+            if (!keep) { continue; }
+        }
+
+        // Rows of (x1, y1, x2, y2) and (x3, y3, x4, y4) per rect
+        __m128 r0 = ox[0], r1 = oy[0], r2 = ox[1], r3 = oy[1];
+        __m128 r4 = ox[2], r5 = oy[2], r6 = ox[3], r7 = oy[3];
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+
+        const __m128 lo[4] = { r0, r1, r2, r3 };
+        const __m128 hi[4] = { r4, r5, r6, r7 };
+
+        for (int k = 0; k < 4; k++) {
+            if (!(keep & (1 << k))) { continue; }
+
+            _mm_storeu_ps(&_out[kept].x1, lo[k]);
+            _mm_storeu_ps(&_out[kept].x3, hi[k]);
+            if (_indices) { _indices[kept] = uint32_t(i + k); }
+            kept++;
+        }
+    }
+#elif defined(ALFONS_NEON)
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x1 = vld1q_f32(&_rects.x1[i]);
+        float32x4_t y1 = vld1q_f32(&_rects.y1[i]);
+        float32x4_t x2 = vld1q_f32(&_rects.x2[i]);
+        float32x4_t y2 = vld1q_f32(&_rects.y2[i]);
+
+        float32x4_t cx[4] = { x1, x1, x2, x2 };
+        float32x4_t cy[4] = { y1, y2, y2, y1 };
+
+        if (placed) {
+            float32x4_t c = vld1q_f32(&_rects.c[i]);
+            float32x4_t s = vld1q_f32(&_rects.s[i]);
+            float32x4_t tx = vld1q_f32(&_rects.tx[i]);
+            float32x4_t ty = vld1q_f32(&_rects.ty[i]);
+
+            for (int k = 0; k < 4; k++) {
+                float32x4_t x = cx[k];
+                cx[k] = vaddq_f32(tx, vsubq_f32(vmulq_f32(c, x), vmulq_f32(s, cy[k])));
+                cy[k] = vaddq_f32(ty, vaddq_f32(vmulq_f32(s, x), vmulq_f32(c, cy[k])));
+            }
+        }
+
+        float32x4_t ox[4], oy[4];
+        for (int k = 0; k < 4; k++) {
+            ox[k] = vaddq_f32(vaddq_f32(vmulq_n_f32(cx[k], m00), vmulq_n_f32(cy[k], m01)),
+                              vdupq_n_f32(m03));
+            oy[k] = vaddq_f32(vaddq_f32(vmulq_n_f32(cx[k], m10), vmulq_n_f32(cy[k], m11)),
+                              vdupq_n_f32(m13));
+        }
+
+        uint32_t keep[4] = { ~0u, ~0u, ~0u, ~0u };
+        if (_clip) {
+            float32x4_t minX = vminq_f32(vminq_f32(ox[0], ox[1]), vminq_f32(ox[2], ox[3]));
+            float32x4_t maxX = vmaxq_f32(vmaxq_f32(ox[0], ox[1]), vmaxq_f32(ox[2], ox[3]));
+            float32x4_t minY = vminq_f32(vminq_f32(oy[0], oy[1]), vminq_f32(oy[2], oy[3]));
+            float32x4_t maxY = vmaxq_f32(vmaxq_f32(oy[0], oy[1]), vmaxq_f32(oy[2], oy[3]));
+
+            uint32x4_t outside = vorrq_u32(
+                vorrq_u32(vcgtq_f32(minX, vdupq_n_f32(_clip->x2)),
+                          vcgtq_f32(minY, vdupq_n_f32(_clip->y2))),
+                vorrq_u32(vcltq_f32(maxX, vdupq_n_f32(_clip->x1)),
+                          vcltq_f32(maxY, vdupq_n_f32(_clip->y1))));
+
+            vst1q_u32(keep, vmvnq_u32(outside));
+            if (!(keep[0] | keep[1] | keep[2] | keep[3])) { continue; }
+        }
+
+        // Interleave into rows of (x1, y1, x2, y2) and (x3, y3, x4, y4)
+        float lo[16], hi[16];
+        vst4q_f32(lo, (float32x4x4_t{{ ox[0], oy[0], ox[1], oy[1] }}));
+        vst4q_f32(hi, (float32x4x4_t{{ ox[2], oy[2], ox[3], oy[3] }}));
+
+        for (int k = 0; k < 4; k++) {
+            if (!keep[k]) { continue; }
+
+            memcpy(&_out[kept].x1, &lo[k * 4], sizeof(float) * 4);
+            memcpy(&_out[kept].x3, &hi[k * 4], sizeof(float) * 4);
+            if (_indices) { _indices[kept] = uint32_t(i + k); }
+            kept++;
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        Rect rect{ _rects.x1[i], _rects.y1[i], _rects.x2[i], _rects.y2[i] };
+        Quad& quad = _out[kept];
+
+        if (placed) {
+            float c = _rects.c[i], s = _rects.s[i];
+            float tx = _rects.tx[i], ty = _rects.ty[i];
+
+            Quad local;
+            local.x1 = tx + c * rect.x1 - s * rect.y1;
+            local.y1 = ty + s * rect.x1 + c * rect.y1;
+            local.x2 = tx + c * rect.x1 - s * rect.y2;
+            local.y2 = ty + s * rect.x1 + c * rect.y2;
+            local.x3 = tx + c * rect.x2 - s * rect.y2;
+            local.y3 = ty + s * rect.x2 + c * rect.y2;
+            local.x4 = tx + c * rect.x2 - s * rect.y1;
+            local.y4 = ty + s * rect.x2 + c * rect.y1;
+
+            quad.x1 = local.x1 * m00 + local.y1 * m01 + m03;
+            quad.y1 = local.x1 * m10 + local.y1 * m11 + m13;
+            quad.x2 = local.x2 * m00 + local.y2 * m01 + m03;
+            quad.y2 = local.x2 * m10 + local.y2 * m11 + m13;
+            quad.x3 = local.x3 * m00 + local.y3 * m01 + m03;
+            quad.y3 = local.x3 * m10 + local.y3 * m11 + m13;
+            quad.x4 = local.x4 * m00 + local.y4 * m01 + m03;
+            quad.y4 = local.x4 * m10 + local.y4 * m11 + m13;
+        } else {
+            transformRect(rect, quad);
+        }
+
+        if (_clip && ((quad.x1 > _clip->x2 && quad.x2 > _clip->x2 &&
+                       quad.x3 > _clip->x2 && quad.x4 > _clip->x2) ||
+                      (quad.y1 > _clip->y2 && quad.y2 > _clip->y2 &&
+                       quad.y3 > _clip->y2 && quad.y4 > _clip->y2) ||
+                      (quad.x1 < _clip->x1 && quad.x2 < _clip->x1 &&
+                       quad.x3 < _clip->x1 && quad.x4 < _clip->x1) ||
+                      (quad.y1 < _clip->y1 && quad.y2 < _clip->y1 &&
+                       quad.y3 < _clip->y1 && quad.y4 < _clip->y1))) {
+            continue;
+        }
+
+        if (_indices) { _indices[kept] = uint32_t(i); }
+        kept++;
+    }
+
+    return kept;
+}
 }
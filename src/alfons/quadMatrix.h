@@ -21,6 +21,40 @@
 
 namespace alfons {
 
+// Rects in structure-of-arrays layout, see QuadMatrix::transformRects()
+struct RectBatch {
+    std::vector<float> x1, y1, x2, y2;
+
+    // Optional placement of each rect before the matrix is applied:
+    // rotation by cos @c and sin @s, then translation by @tx, @ty.
+    // Either empty or of the same size as the rects.
+    std::vector<float> c, s, tx, ty;
+
+    size_t size() const { return x1.size(); }
+
+    bool hasPlacement() const { return !c.empty(); }
+
+    void clear() {
+        x1.clear(); y1.clear(); x2.clear(); y2.clear();
+        c.clear(); s.clear(); tx.clear(); ty.clear();
+    }
+
+    void add(const Rect& rect) {
+        x1.push_back(rect.x1);
+        y1.push_back(rect.y1);
+        x2.push_back(rect.x2);
+        y2.push_back(rect.y2);
+    }
+
+    void add(const Rect& rect, float cos, float sin, float x, float y) {
+        add(rect);
+        c.push_back(cos);
+        s.push_back(sin);
+        tx.push_back(x);
+        ty.push_back(y);
+    }
+};
+
 class QuadMatrix {
 public:
     union {
@@ -34,6 +68,14 @@ public:
         };
     };
 
+    // Whether transformRects() uses SSE2 or NEON. Otherwise it is slower
+    // than transformRect() per rect.
+#if defined(ALFONS_SSE2) || defined(ALFONS_NEON)
+    static constexpr bool simd = true;
+#else
+    static constexpr bool simd = false;
+#endif
+
     QuadMatrix();
 
     void load(const glm::mat4& matrix);
@@ -65,7 +107,21 @@ public:
 
     void transformRect(const Rect& rect, Quad& out) const;
 
+    // Transform all @rects into @out, which must have room for
+    // rects.size() quads. Uses SSE2 or NEON when available.
+    void transformRects(const RectBatch& rects, Quad* out) const;
+
+    // Like above, but drops quads that are entirely outside of @clip:
+    // Quads that are kept are written to the front of @out and their
+    // index in @rects to @indices. Returns the number of quads kept.
+    size_t transformRects(const RectBatch& rects, const Rect& clip, Quad* out,
+                          uint32_t* indices) const;
+
 protected:
     std::vector<glm::mat4> stack;
+
+    // Common part of transformRects(), no clipping when @clip is null
+    size_t transformBatch(const RectBatch& rects, const Rect* clip, Quad* out,
+                          uint32_t* indices) const;
 };
 }
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#include "sdf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace alfons {
+
+static const float INF = 1e20f;
+
+// 1D squared distance transform of @n samples at @f, with @stride
+static void edt1d(float* f, size_t stride, int n, std::vector<float>& d,
+                  std::vector<int>& v, std::vector<float>& z) {
+    v[0] = 0;
+    z[0] = -INF;
+    z[1] = INF;
+
+    for (int q = 1, k = 0; q < n; q++) {
+        float fq = f[q * stride];
+        float s;
+        do {
+            int r = v[k];
+            s = (fq - f[r * stride] + float(q * q) - float(r * r)) / float(q - r) * 0.5f;
+        } while (s <= z[k] && --k > -1);
+
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = INF;
+    }
+
+    for (int q = 0, k = 0; q < n; q++) {
+        while (z[k + 1] < q) { k++; }
+        int r = v[k];
+        d[q] = f[r * stride] + float((q - r) * (q - r));
+    }
+    for (int q = 0; q < n; q++) { f[q * stride] = d[q]; }
+}
+
+// 2D squared distance transform of @grid with size @w x @h, in-place
+static void edt(std::vector<float>& grid, int w, int h) {
+    int n = std::max(w, h);
+    std::vector<float> d(n);
+    std::vector<int> v(n);
+    std::vector<float> z(n + 1);
+
+    for (int x = 0; x < w; x++) { edt1d(&grid[x], w, h, d, v, z); }
+    for (int y = 0; y < h; y++) { edt1d(&grid[y * w], 1, w, d, v, z); }
+}
+
+void distanceField(const GlyphBitmap& _coverage, int _spread, GlyphBitmap& _out) {
+    _spread = std::max(_spread, 1);
+
+    int cw = _coverage.width();
+    int ch = _coverage.height();
+    int w = cw + _spread * 2;
+    int h = ch + _spread * 2;
+
+    // Squared distance to the outline, from outside and from inside
+    std::vector<float> outer(w * h, INF);
+    std::vector<float> inner(w * h, 0);
+
+    for (int y = 0; y < ch; y++) {
+        for (int x = 0; x < cw; x++) {
+            float a = _coverage.buffer[y * cw + x] / 255.f;
+            if (a == 0) { continue; }
+
+            size_t i = (y + _spread) * w + x + _spread;
+            if (a == 1) {
+                outer[i] = 0;
+                inner[i] = INF;
+            } else {
+                float d = 0.5f - a;
+                outer[i] = d > 0 ? d * d : 0;
+                inner[i] = d < 0 ? d * d : 0;
+            }
+        }
+    }
+
+    edt(outer, w, h);
+    edt(inner, w, h);
+
+    _out.x0 = _coverage.x0 - _spread;
+    _out.y0 = _coverage.y0 - _spread;
+    _out.x1 = _coverage.x1 + _spread;
+    _out.y1 = _coverage.y1 + _spread;
+    _out.buffer.resize(w * h);
+
+    float scale = 127.f / _spread;
+
+    for (size_t i = 0; i < _out.buffer.size(); i++) {
+        float d = std::sqrt(inner[i]) - std::sqrt(outer[i]);
+        _out.buffer[i] = std::max(0.f, std::min(255.f, std::round(128.f + d * scale)));
+    }
+}
+
+}
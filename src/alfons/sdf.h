@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include "freetypeHelper.h"
+
+namespace alfons {
+
+/*
+ * Convert a coverage bitmap to a signed distance field using a
+ * Euclidean distance transform (Felzenszwalb & Huttenlocher), with
+ * partially covered pixels treated as sub-pixel edge offsets.
+ *
+ * The result is @spread pixels larger on each side. Distances are
+ * mapped to 0..255 with the outline at 128: values above are inside,
+ * and @spread pixels away from the outline maps to 0 or 255. A @spread
+ * below 1 is taken as 1.
+ */
+void distanceField(const GlyphBitmap& coverage, int spread, GlyphBitmap& out);
+
+}
@@ -10,22 +10,27 @@
 
 #pragma once
 
+#include "alfons.h"
+#include "atlas.h"
+#include "font.h"
 #include "lineLayout.h"
+#include "lineWrap.h"
 #include "quadMatrix.h"
+#include "utils.h"
+#include "vertexBuffer.h"
 
 #include "path/lineSampler.h"
 
+#include <algorithm>
 #include <set>
 #include <map>
 #include <memory>
 #include <limits>
+#include <cmath>
+#include <vector>
 
 namespace alfons {
 
-struct MeshCallback;
-struct AtlasGlyph;
-class GlyphAtlas;
-
 // Declared as a struct for possible other informations about the line
 struct LineMetrics {
     glm::vec4 aabb = {
@@ -52,16 +57,74 @@ struct LineMetrics {
 
 extern LineMetrics NO_METRICS;
 
-class TextBatch {
+namespace detail {
+template <class Sink, class Geometry>
+auto drawHalo(Sink& sink, const Geometry& shape, const AtlasGlyph& glyph,
+              const Geometry& haloShape, const AtlasGlyph& halo, int)
+    -> decltype(sink.drawGlyph(shape, glyph, haloShape, halo)) {
+    sink.drawGlyph(shape, glyph, haloShape, halo);
+}
+
+template <class Sink, class Geometry>
+void drawHalo(Sink& sink, const Geometry& shape, const AtlasGlyph& glyph,
+              const Geometry& haloShape, const AtlasGlyph& halo, long) {
+    sink.drawGlyph(haloShape, halo);
+    sink.drawGlyph(shape, glyph);
+}
+}
+
+// Pass glyph and halo as pair when @sink supports it, otherwise draw
+// the halo first
+template <class Sink, class Geometry>
+void drawHalo(Sink& sink, const Geometry& shape, const AtlasGlyph& glyph,
+              const Geometry& haloShape, const AtlasGlyph& halo) {
+    detail::drawHalo(sink, shape, glyph, haloShape, halo, 0);
+}
+
+/*
+ * Emits the glyphs of LineLayouts to @Sink, which provides the
+ * drawGlyph() methods of MeshCallback - the halo pair variants are
+ * optional. Calls are resolved at compile time, so drawGlyph() of a
+ * concrete sink type can be inlined into the draw loops.
+ * TextBatch is the instantiation for the virtual MeshCallback.
+ */
+template <class Sink>
+class BasicTextBatch {
 public:
-    TextBatch(GlyphAtlas& _atlas, MeshCallback& _mesh);
+    BasicTextBatch(GlyphAtlas& _atlas, Sink& _mesh);
+
+    // Write glyphs into @buffer, see setVertexBuffer()
+    BasicTextBatch(GlyphAtlas& _atlas, VertexBuffer& _buffer);
+
+    // Write glyphs into @buffer, see setInstanceBuffer()
+    BasicTextBatch(GlyphAtlas& _atlas, InstanceBuffer& _buffer);
 
     void setClip(const Rect& clipRect);
     void setClip(float x1, float y1, float x2, float y2);
 
     void clearClip() { m_hasClip = false; }
 
-    /* Use current QuadMatrix for transform */
+    // Draw glyphs together with a halo of @width pixels at font size,
+    // passed as pairs to the sink. 0 disables halos. Glyphs without
+    // halo glyph (see GlyphAtlas::getGlyph) are drawn alone.
+    void setHalo(float width);
+
+    // Write glyph vertices directly into @buffer instead of passing glyphs
+    // to the sink. Halos are written as separate glyphs before their
+    // glyph, with VertexFormat::halo flags. Null to use the sink again.
+    void setVertexBuffer(VertexBuffer* buffer) { m_vertices = buffer; }
+
+    // Color attribute of vertices written from now on
+    void setVertexColor(uint32_t color) { m_vertexColor = color; }
+
+    // Write one GlyphInstance per glyph into @buffer instead of vertices
+    // or passing glyphs to the sink. Halos are written before their glyph.
+    // The transform of drawTransformedShape() must be a rotation, uniform
+    // scale and translation in the xy-plane. Null to disable.
+    void setInstanceBuffer(InstanceBuffer* buffer) { m_instances = buffer; }
+
+    /* Use current QuadMatrix for transform. @metrics receives the bounds
+     * of the transformed quad (or its halo). */
     void drawTransformedShape(const Font& font, const Shape& shape, const glm::vec2& position,
                               float scale, LineMetrics& metrics = NO_METRICS);
 
@@ -83,30 +146,568 @@ public:
         return draw(line, {x, y}, metrics);
     }
 
+    // Draw @line wrapped at @width, see wrap()
     glm::vec2 draw(const LineLayout& line, glm::vec2 position, float width,
                    LineMetrics& metrics = NO_METRICS);
 
+    // Draw @lines of @line from wrap(), one line height apart
+    glm::vec2 draw(const LineLayout& line, const std::vector<LineRange>& lines,
+                   glm::vec2 position, LineMetrics& metrics = NO_METRICS);
+
     glm::vec2 draw(const LineLayout& line, size_t start, size_t end, glm::vec2 position,
                    LineMetrics& metrics = NO_METRICS);
 
     float draw(const LineLayout& line, const LineSampler& path,
                float offsetX = 0, float offsetY = 0);
 
+    // Like draw(), but with the glyph quads transformed by the current
+    // QuadMatrix, e.g. for rotated labels. Transform and clipping are
+    // done for all glyphs of the line at once.
+    glm::vec2 drawTransformed(const LineLayout& line, glm::vec2 position);
+
     QuadMatrix& matrix() { return m_matrix; }
 
 protected:
     GlyphAtlas& m_atlas;
-    MeshCallback& m_mesh;
+    Sink* m_mesh = nullptr;
+
+    VertexBuffer* m_vertices = nullptr;
+    uint32_t m_vertexColor = 0;
+
+    InstanceBuffer* m_instances = nullptr;
 
     bool m_hasClip = false;
     Rect m_clip;
 
+    // GlyphKey::stroke of halo glyphs
+    uint8_t m_halo = 0;
+
+    // Line ranges of draw(line, position, width)
+    std::vector<LineRange> m_lines;
+
     QuadMatrix m_matrix;
 
-    inline bool clip(Rect& rect) const;
-    inline bool clip(Quad& quad) const;
+    // Glyphs of draw(line, path) and drawTransformed() that are
+    // transformed and clipped at once by drawBatch()
+    struct Batch {
+        RectBatch rects;
+        // Halo bounds, or the glyph bounds of glyphs without halo
+        RectBatch haloRects;
+        std::vector<AtlasGlyph> glyphs;
+        // glyph is null for glyphs without halo
+        std::vector<AtlasGlyph> halos;
+
+        std::vector<Quad> quads;
+        std::vector<Quad> haloQuads;
+        std::vector<uint32_t> indices;
+
+        void clear() {
+            rects.clear();
+            haloRects.clear();
+            glyphs.clear();
+            halos.clear();
+        }
+    } m_batch;
+
+    // Add the glyph (and halo) of @shape to m_batch, rotated by the
+    // angle of @cos, @sin and moved to @pivot when @placed is set
+    inline void batchShape(const Font& font, const Shape& shape, const glm::vec2& position,
+                           float scale, bool placed = false, float cos = 1, float sin = 0,
+                           const glm::vec2& pivot = {});
+
+    // Transform m_batch by @matrix, drop clipped glyphs and emit the rest
+    void drawBatch(const QuadMatrix& matrix);
+
+    inline void emitQuad(const Quad& quad, const AtlasGlyph& glyph);
+    inline bool clip(const Rect& rect) const;
+    inline bool clip(const Quad& quad) const;
 
     inline void setupRect(const Shape& shape, const glm::vec2& position,
                           float sizeRatio, Rect& rect, AtlasGlyph& glyph);
+
+    // Add instance of @glyph transformed by m_matrix
+    inline void addInstance(const Shape& shape, const glm::vec2& position,
+                            float sizeRatio, const AtlasGlyph& glyph);
 };
+
+using TextBatch = BasicTextBatch<MeshCallback>;
+
+extern template class BasicTextBatch<MeshCallback>;
+
+template <class Sink>
+BasicTextBatch<Sink>::BasicTextBatch(GlyphAtlas& _atlas, Sink& _mesh)
+    : m_atlas(_atlas), m_mesh(&_mesh) {
+    m_clip.x1 = 0;
+    m_clip.y1 = 0;
+    m_clip.x2 = 0;
+    m_clip.y2 = 0;
+}
+
+template <class Sink>
+BasicTextBatch<Sink>::BasicTextBatch(GlyphAtlas& _atlas, VertexBuffer& _buffer)
+    : m_atlas(_atlas), m_vertices(&_buffer) {
+    m_clip.x1 = 0;
+    m_clip.y1 = 0;
+    m_clip.x2 = 0;
+    m_clip.y2 = 0;
+}
+
+template <class Sink>
+BasicTextBatch<Sink>::BasicTextBatch(GlyphAtlas& _atlas, InstanceBuffer& _buffer)
+    : m_atlas(_atlas), m_instances(&_buffer) {
+    m_clip.x1 = 0;
+    m_clip.y1 = 0;
+    m_clip.x2 = 0;
+    m_clip.y2 = 0;
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::setClip(const Rect& _clipRect) {
+    m_clip = _clipRect;
+    m_hasClip = true;
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::setClip(float x1, float y1, float x2, float y2) {
+    m_clip.x1 = x1;
+    m_clip.y1 = y1;
+    m_clip.x2 = x2;
+    m_clip.y2 = y2;
+
+    m_hasClip = true;
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::setHalo(float _width) {
+    m_halo = GlyphKey::strokeUnits(_width);
+}
+
+template <class Sink>
+bool BasicTextBatch<Sink>::clip(const Rect& _rect) const {
+    if (_rect.x1 > m_clip.x2 || _rect.x2 < m_clip.x1 ||
+        _rect.y1 > m_clip.y2 || _rect.y2 < m_clip.y1) {
+        return true;
+    }
+    return false;
+}
+
+template <class Sink>
+bool BasicTextBatch<Sink>::clip(const Quad& _quad) const {
+    return ((_quad.x1 > m_clip.x2 && _quad.x2 > m_clip.x2 &&
+             _quad.x3 > m_clip.x2 && _quad.x4 > m_clip.x2) ||
+            (_quad.y1 > m_clip.y2 && _quad.y2 > m_clip.y2 &&
+             _quad.y3 > m_clip.y2 && _quad.y4 > m_clip.y2) ||
+            (_quad.x1 < m_clip.x1 && _quad.x2 < m_clip.x1 &&
+             _quad.x3 < m_clip.x1 && _quad.x4 < m_clip.x1) ||
+            (_quad.y1 < m_clip.y1 && _quad.y2 < m_clip.y1 &&
+             _quad.y3 < m_clip.y1 && _quad.y4 < m_clip.y1));
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::setupRect(const Shape& _shape, const glm::vec2& _position,
+                                     float _sizeRatio, Rect& _rect, AtlasGlyph& _atlasGlyph) {
+
+    float glyphScale = _atlasGlyph.scale * _sizeRatio;
+
+    glm::vec2 ul = _position + _shape.position * _sizeRatio +
+        _atlasGlyph.glyph->offset * glyphScale;
+    _rect.x1 = ul.x;
+    _rect.y1 = ul.y;
+    _rect.x2 = ul.x + _atlasGlyph.glyph->size.x * glyphScale;
+    _rect.y2 = ul.y + _atlasGlyph.glyph->size.y * glyphScale;
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::addInstance(const Shape& _shape, const glm::vec2& _position,
+                                       float _sizeRatio, const AtlasGlyph& _atlasGlyph) {
+
+    glm::vec2 origin = _position + _shape.position * _sizeRatio;
+    glm::vec3 p = m_matrix.transform(origin.x, origin.y);
+
+    float glyphScale = _atlasGlyph.scale * _sizeRatio;
+
+    m_instances->addGlyph(p.x, p.y, m_matrix.m00 * glyphScale, m_matrix.m10 * glyphScale,
+                          _atlasGlyph.index);
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::drawShape(const Font& _font, const Shape& _shape,
+                                     const glm::vec2& _position, float _scale,
+                                     LineMetrics& _metrics) {
+
+    if (_shape.isEmpty) { return; }
+
+    AtlasGlyph atlasGlyph;
+    if (!m_atlas.getGlyph(_font, {_shape.face, _shape.codepoint}, atlasGlyph)) {
+        return;
+    }
+
+    Rect rect;
+    setupRect(_shape, _position, _scale, rect, atlasGlyph);
+
+    AtlasGlyph haloGlyph;
+    Rect haloRect;
+    bool halo = m_halo && m_atlas.getGlyph(_font, {_shape.face, _shape.codepoint, m_halo},
+                                           haloGlyph);
+    if (halo) { setupRect(_shape, _position, _scale, haloRect, haloGlyph); }
+
+    const Rect& bounds = halo ? haloRect : rect;
+
+    if (m_hasClip && clip(bounds)) {
+        return;
+    }
+
+    if (m_instances) {
+        glm::vec2 origin = _position + _shape.position * _scale;
+        if (halo) {
+            m_instances->addGlyph(origin.x, origin.y, _scale * haloGlyph.scale, 0,
+                                  haloGlyph.index);
+        }
+        m_instances->addGlyph(origin.x, origin.y, _scale * atlasGlyph.scale, 0,
+                              atlasGlyph.index);
+    } else if (m_vertices) {
+        if (halo) {
+            m_vertices->addGlyph(haloRect, *haloGlyph.glyph, haloGlyph.atlas,
+                                 m_vertexColor, VertexFormat::halo);
+        }
+        m_vertices->addGlyph(rect, *atlasGlyph.glyph, atlasGlyph.atlas, m_vertexColor);
+    } else if (halo) {
+        drawHalo(*m_mesh, rect, atlasGlyph, haloRect, haloGlyph);
+    } else {
+        m_mesh->drawGlyph(rect, atlasGlyph);
+    }
+
+    if (&_metrics != &NO_METRICS) {
+        _metrics.addExtents({bounds.x1, bounds.y1, bounds.x2, bounds.y2});
+    }
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::drawTransformedShape(const Font& _font, const Shape& _shape,
+                                                const glm::vec2& _position, float _scale,
+                                                LineMetrics& _metrics) {
+
+    if (_shape.isEmpty) { return; }
+
+    auto addExtents = [&](const Quad& q) {
+        if (&_metrics == &NO_METRICS) { return; }
+        _metrics.addExtents({ std::min({ q.x1, q.x2, q.x3, q.x4 }),
+                              std::min({ q.y1, q.y2, q.y3, q.y4 }),
+                              std::max({ q.x1, q.x2, q.x3, q.x4 }),
+                              std::max({ q.y1, q.y2, q.y3, q.y4 }) });
+    };
+
+    AtlasGlyph atlasGlyph;
+    if (!m_atlas.getGlyph(_font, {_shape.face, _shape.codepoint}, atlasGlyph)) {
+        return;
+    }
+
+    Rect rect;
+    setupRect(_shape, _position, _scale, rect, atlasGlyph);
+
+    Quad quad;
+    m_matrix.transformRect(rect, quad);
+
+    AtlasGlyph haloGlyph;
+    if (m_halo && m_atlas.getGlyph(_font, {_shape.face, _shape.codepoint, m_halo},
+                                   haloGlyph)) {
+        setupRect(_shape, _position, _scale, rect, haloGlyph);
+
+        Quad haloQuad;
+        m_matrix.transformRect(rect, haloQuad);
+
+        if (m_hasClip && clip(haloQuad)) {
+            return;
+        }
+        addExtents(haloQuad);
+
+        if (m_instances) {
+            addInstance(_shape, _position, _scale, haloGlyph);
+            addInstance(_shape, _position, _scale, atlasGlyph);
+        } else if (m_vertices) {
+            m_vertices->addGlyph(haloQuad, *haloGlyph.glyph, haloGlyph.atlas,
+                                 m_vertexColor, VertexFormat::halo);
+            m_vertices->addGlyph(quad, *atlasGlyph.glyph, atlasGlyph.atlas, m_vertexColor);
+        } else {
+            drawHalo(*m_mesh, quad, atlasGlyph, haloQuad, haloGlyph);
+        }
+        return;
+    }
+
+    if (m_hasClip && clip(quad)) {
+        return;
+    }
+    addExtents(quad);
+
+    if (m_instances) {
+        addInstance(_shape, _position, _scale, atlasGlyph);
+    } else if (m_vertices) {
+        m_vertices->addGlyph(quad, *atlasGlyph.glyph, atlasGlyph.atlas, m_vertexColor);
+    } else {
+        m_mesh->drawGlyph(quad, atlasGlyph);
+    }
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::batchShape(const Font& _font, const Shape& _shape,
+                                      const glm::vec2& _position, float _scale, bool _placed,
+                                      float _cos, float _sin, const glm::vec2& _pivot) {
+
+    if (_shape.isEmpty) { return; }
+
+    AtlasGlyph atlasGlyph;
+    if (!m_atlas.getGlyph(_font, {_shape.face, _shape.codepoint}, atlasGlyph)) {
+        return;
+    }
+
+    Rect rect;
+    setupRect(_shape, _position, _scale, rect, atlasGlyph);
+
+    AtlasGlyph haloGlyph;
+    haloGlyph.glyph = nullptr;
+    Rect haloRect = rect;
+    if (m_halo && m_atlas.getGlyph(_font, {_shape.face, _shape.codepoint, m_halo},
+                                   haloGlyph)) {
+        setupRect(_shape, _position, _scale, haloRect, haloGlyph);
+    }
+
+    if (_placed) {
+        m_batch.rects.add(rect, _cos, _sin, _pivot.x, _pivot.y);
+        if (m_halo) { m_batch.haloRects.add(haloRect, _cos, _sin, _pivot.x, _pivot.y); }
+    } else {
+        m_batch.rects.add(rect);
+        if (m_halo) { m_batch.haloRects.add(haloRect); }
+    }
+    m_batch.glyphs.push_back(atlasGlyph);
+    if (m_halo) { m_batch.halos.push_back(haloGlyph); }
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::emitQuad(const Quad& _quad, const AtlasGlyph& _atlasGlyph) {
+    if (m_vertices) {
+        m_vertices->addGlyph(_quad, *_atlasGlyph.glyph, _atlasGlyph.atlas, m_vertexColor);
+    } else {
+        m_mesh->drawGlyph(_quad, _atlasGlyph);
+    }
+}
+
+template <class Sink>
+void BasicTextBatch<Sink>::drawBatch(const QuadMatrix& _matrix) {
+
+    size_t count = m_batch.glyphs.size();
+    if (count == 0) { return; }
+
+    auto& quads = m_batch.quads;
+    auto& indices = m_batch.indices;
+
+    quads.resize(count);
+    indices.resize(count);
+
+    if (!m_halo) {
+        if (!m_hasClip) {
+            _matrix.transformRects(m_batch.rects, quads.data());
+
+            for (size_t i = 0; i < count; i++) { emitQuad(quads[i], m_batch.glyphs[i]); }
+            return;
+        }
+        size_t kept = _matrix.transformRects(m_batch.rects, m_clip, quads.data(),
+                                             indices.data());
+
+        for (size_t k = 0; k < kept; k++) { emitQuad(quads[k], m_batch.glyphs[indices[k]]); }
+        return;
+    }
+
+    // Clip by the halo bounds, then pass glyphs and halos as pairs
+    auto& haloQuads = m_batch.haloQuads;
+    haloQuads.resize(count);
+
+    _matrix.transformRects(m_batch.rects, quads.data());
+
+    size_t kept = count;
+    if (m_hasClip) {
+        kept = _matrix.transformRects(m_batch.haloRects, m_clip, haloQuads.data(),
+                                      indices.data());
+    } else {
+        _matrix.transformRects(m_batch.haloRects, haloQuads.data());
+        for (size_t i = 0; i < count; i++) { indices[i] = uint32_t(i); }
+    }
+
+    for (size_t k = 0; k < kept; k++) {
+        uint32_t i = indices[k];
+        auto& atlasGlyph = m_batch.glyphs[i];
+        auto& haloGlyph = m_batch.halos[i];
+
+        if (!haloGlyph.glyph) {
+            emitQuad(quads[i], atlasGlyph);
+        } else if (m_vertices) {
+            m_vertices->addGlyph(haloQuads[k], *haloGlyph.glyph, haloGlyph.atlas,
+                                 m_vertexColor, VertexFormat::halo);
+            m_vertices->addGlyph(quads[i], *atlasGlyph.glyph, atlasGlyph.atlas, m_vertexColor);
+        } else {
+            drawHalo(*m_mesh, quads[i], atlasGlyph, haloQuads[k], haloGlyph);
+        }
+    }
+}
+
+template <class Sink>
+glm::vec2 BasicTextBatch<Sink>::draw(const LineLayout& _line, glm::vec2 _position,
+                                     LineMetrics& _metrics) {
+    return draw(_line, 0, _line.shapes().size(), _position, _metrics);
+}
+
+template <class Sink>
+glm::vec2 BasicTextBatch<Sink>::drawShapeRange(const LineLayout& _line, size_t _start,
+                                               size_t _end, glm::vec2 _position,
+                                               LineMetrics& _metrics) {
+
+    for (size_t j = _start; j < _end; j++) {
+        auto& c = _line.shapes()[j];
+        if (!c.isSpace) {
+            drawShape(_line.font(), c, _position, _line.scale(), _metrics);
+        }
+
+        _position.x += _line.advance(c);
+    }
+    return _position;
+}
+
+template <class Sink>
+glm::vec2 BasicTextBatch<Sink>::draw(const LineLayout& _line, size_t _start, size_t _end,
+                                     glm::vec2 _position, LineMetrics& _metrics) {
+
+    float startX = _position.x;
+
+    for (size_t j = _start; j < _end; j++) {
+        auto& c = _line.shapes()[j];
+        if (!c.isSpace) {
+            drawShape(_line.font(), c, _position, _line.scale(), _metrics);
+        }
+
+        _position.x += _line.advance(c);
+        if (c.mustBreak) {
+            _position.x = startX;
+            _position.y += _line.height();
+        }
+    }
+
+    _position.y += _line.height();
+
+    return _position;
+}
+
+template <class Sink>
+glm::vec2 BasicTextBatch<Sink>::draw(const LineLayout& _line, glm::vec2 _position, float _width,
+                                     LineMetrics& _metrics) {
+
+    wrap(_line, _width, m_lines);
+
+    return draw(_line, m_lines, _position, _metrics);
+}
+
+template <class Sink>
+glm::vec2 BasicTextBatch<Sink>::draw(const LineLayout& _line, const std::vector<LineRange>& _lines,
+                                     glm::vec2 _position, LineMetrics& _metrics) {
+
+    if (_lines.empty()) { return _position; }
+
+    float startX = _position.x;
+    float adv = 0;
+
+    for (auto& range : _lines) {
+        adv = std::max(adv, drawShapeRange(_line, range.start, range.end,
+                                           _position, _metrics).x);
+        _position.y += _line.height();
+        _position.x = startX;
+    }
+
+    _position.x = adv;
+    return _position;
+}
+
+template <class Sink>
+float BasicTextBatch<Sink>::draw(const LineLayout& _line, const LineSampler& _path,
+                                 float _offsetX, float _offsetY) {
+
+    bool reverse = false; //(line.direction() == HB_DIRECTION_RTL);
+    float direction = reverse ? -1 : 1;
+    // float sampleSize = 0.1 * line.height();
+
+    auto& font = _line.font();
+    float scale = _line.scale();
+
+    glm::vec2 position;
+    float angle;
+
+    // Instances carry their own rotation. Without SIMD glyphs are
+    // transformed one by one.
+    if (m_instances || !QuadMatrix::simd) {
+        for (auto& shape : DirectionalRange(_line.shapes(), reverse)) {
+            float half = 0.5f * shape.advance * scale * direction;
+            _offsetX += half;
+
+            if (!shape.isSpace) {
+                _path.get(_offsetX, position, angle);
+
+                m_matrix.setTranslation(position);
+                m_matrix.rotateZ(angle);
+
+                drawTransformedShape(font, shape, -half, _offsetY, scale);
+            }
+            _offsetX += half;
+        }
+        return _offsetX;
+    }
+
+    m_batch.clear();
+
+    for (auto& shape : DirectionalRange(_line.shapes(), reverse)) {
+        //float half = 0.5f * line.advance(shape) * direction;
+        float half = 0.5f * shape.advance * scale * direction;
+        _offsetX += half;
+
+        if (!shape.isSpace) {
+            _path.get(_offsetX, position, angle);
+
+            //m_matrix.rotateZ(path.offset2SampledAngle(offsetX, sampleSize));
+            batchShape(font, shape, {-half, _offsetY}, scale, true,
+                       std::cos(angle), std::sin(angle), position);
+        }
+        _offsetX += half;
+    }
+
+    // Glyph placement along the path is part of the batch
+    drawBatch(QuadMatrix());
+
+    return _offsetX;
+}
+
+template <class Sink>
+glm::vec2 BasicTextBatch<Sink>::drawTransformed(const LineLayout& _line, glm::vec2 _position) {
+
+    auto& font = _line.font();
+    float scale = _line.scale();
+
+    if (m_instances || !QuadMatrix::simd) {
+        for (auto& shape : _line.shapes()) {
+            if (!shape.isSpace) {
+                drawTransformedShape(font, shape, _position, scale);
+            }
+            _position.x += _line.advance(shape);
+        }
+        return _position;
+    }
+
+    m_batch.clear();
+
+    for (auto& shape : _line.shapes()) {
+        if (!shape.isSpace) { batchShape(font, shape, _position, scale); }
+
+        _position.x += _line.advance(shape);
+    }
+
+    drawBatch(m_matrix);
+
+    return _position;
+}
+
 }
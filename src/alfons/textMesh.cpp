@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#include "textMesh.h"
+
+#include <algorithm>
+
+namespace alfons {
+
+void TextMesh::build(const LineLayout& _line, glm::vec2 _position, float _halo) {
+    m_line = _line;
+    m_position = _position;
+    m_stroke = GlyphKey::strokeUnits(_halo);
+
+    resolve();
+}
+
+void TextMesh::resolve() {
+    m_rects.clear();
+    m_haloRects.clear();
+    m_glyphs.clear();
+    m_halos.clear();
+    m_glyphVersions.clear();
+    m_haloVersions.clear();
+
+    m_version = m_atlas.version();
+    m_frame = m_atlas.frame();
+
+    auto& font = m_line.font();
+    float scale = m_line.scale();
+    glm::vec2 position = m_position;
+
+    auto setupRect = [&](const Shape& shape, const AtlasGlyph& atlasGlyph, Rect& rect) {
+        float glyphScale = atlasGlyph.scale * scale;
+
+        glm::vec2 ul = position + shape.position * scale +
+            atlasGlyph.glyph->offset * glyphScale;
+        rect.x1 = ul.x;
+        rect.y1 = ul.y;
+        rect.x2 = ul.x + atlasGlyph.glyph->size.x * glyphScale;
+        rect.y2 = ul.y + atlasGlyph.glyph->size.y * glyphScale;
+    };
+
+    bool first = true;
+    m_bounds = { 0, 0, 0, 0 };
+
+    for (auto& shape : m_line.shapes()) {
+        if (!shape.isSpace && !shape.isEmpty) {
+            AtlasGlyph atlasGlyph;
+            if (m_atlas.getGlyph(font, {shape.face, shape.codepoint}, atlasGlyph)) {
+                Rect rect;
+                setupRect(shape, atlasGlyph, rect);
+
+                AtlasGlyph haloGlyph;
+                haloGlyph.glyph = nullptr;
+                Rect haloRect = rect;
+                if (m_stroke && m_atlas.getGlyph(font, {shape.face, shape.codepoint, m_stroke},
+                                                 haloGlyph)) {
+                    setupRect(shape, haloGlyph, haloRect);
+                }
+
+                m_rects.add(rect);
+                m_haloRects.add(haloRect);
+                m_glyphs.push_back(atlasGlyph);
+                m_halos.push_back(haloGlyph);
+                m_glyphVersions.push_back(m_atlas.glyphVersion(atlasGlyph.index));
+                m_haloVersions.push_back(haloGlyph.glyph ?
+                                         m_atlas.glyphVersion(haloGlyph.index) : 0);
+
+                if (first) {
+                    m_bounds = haloRect;
+                    first = false;
+                } else {
+                    m_bounds.x1 = std::min(m_bounds.x1, haloRect.x1);
+                    m_bounds.y1 = std::min(m_bounds.y1, haloRect.y1);
+                    m_bounds.x2 = std::max(m_bounds.x2, haloRect.x2);
+                    m_bounds.y2 = std::max(m_bounds.y2, haloRect.y2);
+                }
+            }
+        }
+        position.x += m_line.advance(shape);
+    }
+}
+
+bool TextMesh::isValid() const {
+    if (m_version == m_atlas.version()) { return true; }
+
+    for (size_t i = 0; i < m_glyphs.size(); i++) {
+        if (m_atlas.glyphVersion(m_glyphs[i].index) != m_glyphVersions[i]) { return false; }
+
+        if (m_halos[i].glyph &&
+            m_atlas.glyphVersion(m_halos[i].index) != m_haloVersions[i]) { return false; }
+    }
+
+    // Only other glyphs changed
+    m_version = m_atlas.version();
+    return true;
+}
+
+void TextMesh::update() {
+    if (!isValid()) {
+        resolve();
+        return;
+    }
+
+    if (m_frame == m_atlas.frame()) { return; }
+    m_frame = m_atlas.frame();
+
+    for (size_t i = 0; i < m_glyphs.size(); i++) {
+        m_atlas.markUsed(m_glyphs[i].index);
+        if (m_halos[i].glyph) { m_atlas.markUsed(m_halos[i].index); }
+    }
+}
+
+}
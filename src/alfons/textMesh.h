@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include "alfons.h"
+#include "atlas.h"
+#include "lineLayout.h"
+#include "quadMatrix.h"
+#include "textBatch.h"
+#include "vertexBuffer.h"
+
+#include <vector>
+
+namespace alfons {
+
+/*
+ * Glyphs of a LineLayout resolved once, for labels that are drawn
+ * every frame with only a different transform or color: draw() emits
+ * the retained quads without atlas lookups.
+ * When the atlas evicts or moves one of the glyphs (see
+ * GlyphAtlas::version()) the mesh is rebuilt on the next draw().
+ */
+class TextMesh {
+public:
+    TextMesh(GlyphAtlas& _atlas) : m_atlas(_atlas) {}
+
+    // Resolve the glyphs of @line drawn at @position, as by
+    // TextBatch::draw(), with halos of @halo pixels (see TextBatch::setHalo)
+    void build(const LineLayout& line, glm::vec2 position = {0, 0}, float halo = 0);
+
+    // Whether all glyphs are still where they were resolved to
+    bool isValid() const;
+
+    // Rebuild when glyphs were evicted or moved and mark the glyphs as used
+    // in the current frame. Called by draw().
+    void update();
+
+    // Emit glyphs transformed by @matrix to @sink - a MeshCallback, a
+    // sink of BasicTextBatch or a VertexBuffer. Glyphs entirely outside
+    // of @clip are dropped.
+    template <class Sink>
+    void draw(Sink& sink, const QuadMatrix& matrix, const Rect* clip = nullptr);
+
+    // Emit glyphs scaled by @scale and moved by @offset
+    template <class Sink>
+    void draw(Sink& sink, glm::vec2 offset, float scale = 1);
+
+    // Color attribute of glyphs written to a VertexBuffer
+    void setVertexColor(uint32_t color) { m_vertexColor = color; }
+
+    size_t size() const { return m_glyphs.size(); }
+
+    bool empty() const { return m_glyphs.empty(); }
+
+    // Bounds of glyphs and halos in layout space
+    const Rect& bounds() const { return m_bounds; }
+
+private:
+    void resolve();
+
+    template <class Sink, class Geometry>
+    void emit(Sink& sink, size_t i, const Geometry& shape, const Geometry& haloShape) {
+        auto& halo = m_halos[i];
+        if (halo.glyph) {
+            drawHalo(sink, shape, m_glyphs[i], haloShape, halo);
+        } else {
+            sink.drawGlyph(shape, m_glyphs[i]);
+        }
+    }
+
+    template <class Geometry>
+    void emit(VertexBuffer& buffer, size_t i, const Geometry& shape, const Geometry& haloShape) {
+        auto& glyph = m_glyphs[i];
+        auto& halo = m_halos[i];
+        if (halo.glyph) {
+            buffer.addGlyph(haloShape, *halo.glyph, halo.atlas, m_vertexColor, VertexFormat::halo);
+        }
+        buffer.addGlyph(shape, *glyph.glyph, glyph.atlas, m_vertexColor);
+    }
+
+    GlyphAtlas& m_atlas;
+
+    // Source of the mesh, kept for rebuilding
+    LineLayout m_line;
+    glm::vec2 m_position;
+    uint8_t m_stroke = 0;
+
+    // Glyph rects in layout space
+    RectBatch m_rects;
+    // Halo bounds, or the glyph bounds of glyphs without halo
+    RectBatch m_haloRects;
+
+    std::vector<AtlasGlyph> m_glyphs;
+    // glyph is null for glyphs without halo
+    std::vector<AtlasGlyph> m_halos;
+
+    // GlyphAtlas::glyphVersion() of glyphs and halos at build time
+    std::vector<uint32_t> m_glyphVersions;
+    std::vector<uint32_t> m_haloVersions;
+
+    // GlyphAtlas::version() when the glyphs were last found valid
+    mutable uint32_t m_version = 0;
+    // GlyphAtlas::frame() of the last update()
+    uint32_t m_frame = 0;
+
+    Rect m_bounds = { 0, 0, 0, 0 };
+    uint32_t m_vertexColor = 0;
+
+    // Transformed quads of draw()
+    std::vector<Quad> m_quads;
+    std::vector<Quad> m_haloQuads;
+    std::vector<uint32_t> m_indices;
+};
+
+template <class Sink>
+void TextMesh::draw(Sink& _sink, const QuadMatrix& _matrix, const Rect* _clip) {
+
+    update();
+
+    size_t count = m_glyphs.size();
+    if (count == 0) { return; }
+
+    m_quads.resize(count);
+    m_haloQuads.resize(count);
+    m_indices.resize(count);
+
+    _matrix.transformRects(m_rects, m_quads.data());
+
+    size_t kept = count;
+    if (_clip) {
+        kept = _matrix.transformRects(m_haloRects, *_clip, m_haloQuads.data(),
+                                      m_indices.data());
+    } else {
+        _matrix.transformRects(m_haloRects, m_haloQuads.data());
+        for (size_t i = 0; i < count; i++) { m_indices[i] = uint32_t(i); }
+    }
+
+    for (size_t k = 0; k < kept; k++) {
+        uint32_t i = m_indices[k];
+        emit(_sink, i, m_quads[i], m_haloQuads[k]);
+    }
+}
+
+template <class Sink>
+void TextMesh::draw(Sink& _sink, glm::vec2 _offset, float _scale) {
+
+    update();
+
+    for (size_t i = 0; i < m_glyphs.size(); i++) {
+        Rect rect{ _offset.x + m_rects.x1[i] * _scale, _offset.y + m_rects.y1[i] * _scale,
+                   _offset.x + m_rects.x2[i] * _scale, _offset.y + m_rects.y2[i] * _scale };
+
+        if (!m_halos[i].glyph) {
+            emit(_sink, i, rect, rect);
+            continue;
+        }
+        Rect halo{ _offset.x + m_haloRects.x1[i] * _scale, _offset.y + m_haloRects.y1[i] * _scale,
+                   _offset.x + m_haloRects.x2[i] * _scale, _offset.y + m_haloRects.y2[i] * _scale };
+
+        emit(_sink, i, rect, halo);
+    }
+}
+
+}
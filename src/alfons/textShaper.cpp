@@ -306,6 +306,9 @@ bool TextShaper::processRun(const FontFace& _face, const TextRun& _run,
     bool missingGlyphs = false;
     bool addedGlyphs = false;
 
+    // Positions of bitmap-only fonts are in units of the bitmap strike
+    float scale = FT_INV_SCALE * _face.bitmapScale();
+
     for (size_t pos = 0; pos < glyphCount; pos++) {
         hb_codepoint_t codepoint = glyphInfos[pos].codepoint;
         uint32_t clusterId = glyphInfos[pos].cluster;
@@ -330,10 +333,13 @@ bool TextShaper::processRun(const FontFace& _face, const TextRun& _run,
             continue;
         }
 
-        auto offset = glm::vec2(glyphPositions[pos].x_offset * FT_INV_SCALE,
-                                -glyphPositions[pos].y_offset * FT_INV_SCALE);
+        auto offset = glm::vec2(glyphPositions[pos].x_offset * scale,
+                                -glyphPositions[pos].y_offset * scale);
+
+        float advance = glyphPositions[pos].x_advance * scale;
 
-        float advance = glyphPositions[pos].x_advance * FT_INV_SCALE;
+        uint8_t glyphFlags = _face.glyphFlags(codepoint);
+        uint8_t emptyFlag = (glyphFlags & FontFace::GlyphFlag::empty) ? 32 : 0;
 
         if (m_glyphAdded[id]) {
             m_glyphAdded[id] = 2;
@@ -341,7 +347,7 @@ bool TextShaper::processRun(const FontFace& _face, const TextRun& _run,
             if (m_clusters.size() < m_shapes.size()) {
                 m_clusters.resize(m_shapes.size());
             }
-            m_clusters[id].emplace_back(_face.id(), codepoint, offset, advance, 0);
+            m_clusters[id].emplace_back(_face.id(), codepoint, offset, advance, emptyFlag);
 
         } else {
             addedGlyphs = true;
@@ -353,7 +359,8 @@ bool TextShaper::processRun(const FontFace& _face, const TextRun& _run,
                 ((breakmode == LINEBREAK_MUSTBREAK) ? 2 : 0) |
                 ((breakmode == LINEBREAK_ALLOWBREAK) ? 4 : 0) |
                 ((breakmode == LINEBREAK_NOBREAK) ? 8 : 0) |
-                (_face.isSpace(codepoint) ? 16 : 0);
+                ((glyphFlags & FontFace::GlyphFlag::space) ? 16 : 0) |
+                emptyFlag;
 
             m_shapes[id] = Shape(_face.id(), codepoint, offset, advance, flags);
         }
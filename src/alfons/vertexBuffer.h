@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include "alfons.h"
+#include "glyph.h"
+
+#include <cstring>
+#include <vector>
+
+namespace alfons {
+
+// Layout of interleaved glyph vertices. Offsets are in bytes from the
+// start of a vertex, -1 for attributes that are not part of it.
+struct VertexFormat {
+    // Flags of halo glyphs, see TextBatch::setHalo()
+    static constexpr uint8_t halo = 1;
+
+    // Bytes per vertex
+    int stride = 12;
+
+    // 2 x float
+    int position = 0;
+    // 2 x uint16_t texel coordinates in the atlas page, including padding
+    int uv = 8;
+    // uint16_t AtlasID
+    int page = -1;
+    // uint32_t, see TextBatch::setVertexColor()
+    int color = -1;
+    // uint8_t
+    int flags = -1;
+};
+
+// Caller-provided storage for glyph vertices: 4 per glyph, in the corner
+// order of Quad (top-left, bottom-left, bottom-right, top-right), i.e.
+// two triangles 0,1,2 and 0,2,3.
+struct VertexBuffer {
+    VertexFormat format;
+
+    unsigned char* data = nullptr;
+    // Size of data in vertices
+    size_t capacity = 0;
+    // Vertices written
+    size_t count = 0;
+    // Glyphs written per atlas page, indexed by AtlasID
+    std::vector<uint32_t> pageGlyphs;
+
+    struct PageRange {
+        AtlasID page;
+        // In glyphs: vertices [4 * first, 4 * (first + count))
+        size_t first, count;
+    };
+    // Runs of consecutive glyphs of one page, in drawing order: Draw each
+    // run with the texture of its page, without a page attribute.
+    std::vector<PageRange> pageRanges;
+    // Glyphs not written because the buffer was full
+    size_t dropped = 0;
+
+    VertexBuffer() {}
+
+    VertexBuffer(const VertexFormat& format, unsigned char* data, size_t capacity)
+        : format(format), data(data), capacity(capacity) {}
+
+    // Start writing at the beginning of @data again
+    void reset() {
+        count = 0;
+        dropped = 0;
+        pageGlyphs.clear();
+        pageRanges.clear();
+    }
+
+    bool addGlyph(const Rect& rect, const Glyph& glyph, AtlasID page,
+                  uint32_t color = 0, uint8_t flags = 0) {
+        const float position[8] = { rect.x1, rect.y1, rect.x1, rect.y2,
+                                    rect.x2, rect.y2, rect.x2, rect.y1 };
+        return addVertices(position, glyph, page, color, flags);
+    }
+
+    bool addGlyph(const Quad& quad, const Glyph& glyph, AtlasID page,
+                  uint32_t color = 0, uint8_t flags = 0) {
+        const float position[8] = { quad.x1, quad.y1, quad.x2, quad.y2,
+                                    quad.x3, quad.y3, quad.x4, quad.y4 };
+        return addVertices(position, glyph, page, color, flags);
+    }
+
+private:
+    bool addVertices(const float* position, const Glyph& glyph, AtlasID page,
+                     uint32_t color, uint8_t flags) {
+
+        if (count + 4 > capacity) {
+            dropped++;
+            return false;
+        }
+
+        const uint16_t uv[8] = { glyph.u1, glyph.v1, glyph.u1, glyph.v2,
+                                 glyph.u2, glyph.v2, glyph.u2, glyph.v1 };
+        uint16_t pageIndex = uint16_t(page);
+
+        unsigned char* vertex = data + count * format.stride;
+
+        for (int i = 0; i < 4; i++, vertex += format.stride) {
+            memcpy(vertex + format.position, &position[i * 2], sizeof(float) * 2);
+
+            if (format.uv >= 0) { memcpy(vertex + format.uv, &uv[i * 2], sizeof(uint16_t) * 2); }
+            if (format.page >= 0) { memcpy(vertex + format.page, &pageIndex, sizeof(pageIndex)); }
+            if (format.color >= 0) { memcpy(vertex + format.color, &color, sizeof(color)); }
+            if (format.flags >= 0) { vertex[format.flags] = flags; }
+        }
+        count += 4;
+
+        if (page >= pageGlyphs.size()) { pageGlyphs.resize(page + 1); }
+        pageGlyphs[page]++;
+
+        if (pageRanges.empty() || pageRanges.back().page != page) {
+            pageRanges.push_back({ page, count / 4 - 1, 0 });
+        }
+        pageRanges.back().count++;
+
+        return true;
+    }
+};
+
+// One glyph for instanced drawing with GlyphAtlas::glyphTable(). With
+// entry = glyphTable()[glyph], corner c in {0, 1}^2 of the glyph quad is
+//   v = (entry.x, entry.y) + c * (entry.w, entry.h)
+//   (x + a * v.x - b * v.y, y + b * v.x + a * v.y)
+// and samples texel mix((u1, v1), (u2, v2), c) of page entry.atlas.
+struct GlyphInstance {
+    float x, y;
+    // Scale and rotation: scale * (cos, sin)
+    float a, b;
+    uint32_t glyph;
+};
+
+// Caller-provided storage for glyph instances
+struct InstanceBuffer {
+    GlyphInstance* data = nullptr;
+    size_t capacity = 0;
+    size_t count = 0;
+    // Glyphs not written because the buffer was full
+    size_t dropped = 0;
+
+    InstanceBuffer() {}
+
+    InstanceBuffer(GlyphInstance* data, size_t capacity)
+        : data(data), capacity(capacity) {}
+
+    void reset() {
+        count = 0;
+        dropped = 0;
+    }
+
+    bool addGlyph(float x, float y, float a, float b, uint32_t glyph) {
+        if (count == capacity) {
+            dropped++;
+            return false;
+        }
+        data[count++] = { x, y, a, b, glyph };
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// GlyphAtlas::compact(): dropped and moved glyphs against the returned
+// GlyphMoves, glyph versions, texel content at the new positions and the
+// textures that are removed.
+
+#include "alfons/atlas.h"
+#include "alfons/font.h"
+#include "test.h"
+#include "testFont.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace alfons;
+
+// Keeps the uploaded pixels of each page
+struct Textures : TextureCallback {
+    struct Page {
+        uint16_t width, height;
+        std::vector<unsigned char> pixels;
+    };
+    std::vector<Page> pages;
+
+    void addTexture(AtlasID id, uint16_t w, uint16_t h) override {
+        if (pages.size() <= id) { pages.resize(id + 1); }
+        pages[id] = { w, h, std::vector<unsigned char>(w * h) };
+    }
+    void addGlyph(AtlasID id, uint16_t gx, uint16_t gy, uint16_t gw, uint16_t gh,
+                  const unsigned char* src, uint16_t padding) override {
+        auto& page = pages[id];
+        for (int y = 0; y < gh; y++) {
+            memcpy(&page.pixels[(gy + padding + y) * page.width + gx + padding],
+                   src + y * gw, gw);
+        }
+    }
+    void removeTexture(AtlasID id) override {
+        CHECK(id + 1 == pages.size());
+        pages.pop_back();
+    }
+
+    // Texels of @entry including padding
+    std::vector<unsigned char> pixels(const AtlasGlyph& _entry) const {
+        auto& page = pages[_entry.atlas];
+        auto& g = *_entry.glyph;
+        std::vector<unsigned char> out;
+        for (int y = g.v1; y < g.v2; y++) {
+            auto row = &page.pixels[y * page.width];
+            out.insert(out.end(), row + g.u1, row + g.u2);
+        }
+        return out;
+    }
+};
+
+struct Tracked {
+    GlyphKey key;
+    AtlasGlyph entry;
+    uint32_t version;
+    Glyph glyph;
+    std::vector<unsigned char> pixels;
+};
+
+int main() {
+    FreetypeHelper ft;
+    InputSource source(testFont());
+
+    auto font = std::make_shared<Font>(Font::Properties(64));
+    auto face = std::make_shared<FontFace>(ft, 0, FontFace::Descriptor(source), 64);
+    face->load();
+    font->addFace(face);
+
+    Textures textures;
+    GlyphAtlas atlas(textures, 128);
+
+    std::vector<Tracked> glyphs;
+    for (uint32_t gid = 2; gid < 54; gid++) {
+        AtlasGlyph entry;
+        CHECK(atlas.getGlyph(*font, { 0, gid }, entry));
+        glyphs.push_back({ GlyphKey(0, gid), entry, atlas.glyphVersion(entry.index),
+                           *entry.glyph, textures.pixels(entry) });
+    }
+    size_t pageCount = textures.pages.size();
+    CHECK(pageCount > 2);
+
+    // No page is filled less than 0, no glyph older than the default age
+    CHECK(atlas.compact(0).empty());
+
+    // Use every third glyph in the current frame
+    atlas.advanceFrame();
+    for (size_t i = 0; i < glyphs.size(); i += 3) {
+        AtlasGlyph entry;
+        CHECK(atlas.findGlyph(glyphs[i].key, entry));
+    }
+
+    uint32_t version = atlas.version();
+    auto moves = atlas.compact(1, 0);
+    CHECK(atlas.version() != version);
+    CHECK(textures.pages.size() < pageCount);
+
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        auto& t = glyphs[i];
+        auto move = std::find_if(moves.begin(), moves.end(),
+                                 [&](const GlyphAtlas::GlyphMove& m) { return m.key == t.key; });
+        AtlasGlyph entry;
+
+        if (i % 3 != 0) {
+            // Dropped
+            CHECK(move != moves.end() && move->newAtlas == GlyphIndex::npos && !move->glyph);
+            CHECK(!atlas.findGlyph(t.key, entry));
+            CHECK(atlas.glyphVersion(t.entry.index) != t.version);
+            continue;
+        }
+
+        // Same Glyph, new data only when moved
+        CHECK(atlas.findGlyph(t.key, entry));
+        CHECK(entry.glyph == t.entry.glyph && entry.index == t.entry.index);
+
+        if (move == moves.end()) {
+            CHECK(atlas.glyphVersion(entry.index) == t.version);
+            CHECK(entry.atlas == t.entry.atlas);
+        } else {
+            CHECK(atlas.glyphVersion(entry.index) != t.version);
+            CHECK(move->oldAtlas == t.entry.atlas && move->newAtlas == entry.atlas);
+            CHECK(move->glyph == entry.glyph);
+        }
+
+        // Same size and texels at the new position
+        auto& g = *entry.glyph;
+        CHECK(g.u2 - g.u1 == t.glyph.u2 - t.glyph.u1 && g.v2 - g.v1 == t.glyph.v2 - t.glyph.v1);
+        CHECK(g.offset == t.glyph.offset && g.size == t.glyph.size);
+        CHECK(entry.atlas < textures.pages.size());
+        if (entry.atlas < textures.pages.size()) { CHECK(textures.pixels(entry) == t.pixels); }
+
+        auto& table = atlas.glyphTable()[entry.index];
+        CHECK(table.u1 == g.u1 && table.v1 == g.v1 && table.u2 == g.u2 && table.v2 == g.v2);
+        CHECK(table.atlas == entry.atlas);
+
+        // No overlaps
+        for (size_t j = 0; j < i; j += 3) {
+            AtlasGlyph other;
+            atlas.findGlyph(glyphs[j].key, other);
+            if (other.atlas != entry.atlas) { continue; }
+
+            auto& o = *other.glyph;
+            CHECK(o.u2 <= g.u1 || g.u2 <= o.u1 || o.v2 <= g.v1 || g.v2 <= o.v1);
+        }
+    }
+    CHECK(moves.size() >= glyphs.size() - (glyphs.size() + 2) / 3);
+
+    // Nothing left to do
+    version = atlas.version();
+    CHECK(atlas.compact(1, 0).empty());
+    CHECK(atlas.version() == version);
+
+    // New glyphs go into the compacted pages
+    AtlasGlyph entry;
+    CHECK(atlas.getGlyph(*font, { 0, 3 }, entry));
+    CHECK(entry.atlas < textures.pages.size());
+
+    return TEST_RESULT();
+}
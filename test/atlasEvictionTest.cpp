@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// GlyphAtlas eviction of the least recently used page when setMaxAtlases()
+// is reached and by evict(): EvictionCallback keys, recycled pages and
+// AtlasGlyph data of the remaining glyphs.
+
+#include "alfons/atlas.h"
+#include "alfons/font.h"
+#include "test.h"
+#include "testFont.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace alfons;
+
+// Keeps the uploaded pixels of each page
+struct Textures : TextureCallback {
+    struct Page {
+        uint16_t width, height;
+        std::vector<unsigned char> pixels;
+    };
+    std::vector<Page> pages;
+    size_t added = 0;
+
+    void addTexture(AtlasID id, uint16_t w, uint16_t h) override {
+        if (pages.size() <= id) { pages.resize(id + 1); }
+        pages[id] = { w, h, std::vector<unsigned char>(w * h) };
+        added++;
+    }
+    void addGlyph(AtlasID id, uint16_t gx, uint16_t gy, uint16_t gw, uint16_t gh,
+                  const unsigned char* src, uint16_t padding) override {
+        auto& page = pages[id];
+        for (int y = 0; y < gh; y++) {
+            memcpy(&page.pixels[(gy + padding + y) * page.width + gx + padding],
+                   src + y * gw, gw);
+        }
+    }
+
+    // Texels of @entry including padding
+    std::vector<unsigned char> pixels(const AtlasGlyph& _entry) const {
+        auto& page = pages[_entry.atlas];
+        auto& g = *_entry.glyph;
+        std::vector<unsigned char> out;
+        for (int y = g.v1; y < g.v2; y++) {
+            auto row = &page.pixels[y * page.width];
+            out.insert(out.end(), row + g.u1, row + g.u2);
+        }
+        return out;
+    }
+};
+
+struct Tracked {
+    GlyphKey key;
+    AtlasGlyph entry;
+    uint32_t version;
+    Glyph glyph;
+    std::vector<unsigned char> pixels;
+};
+
+static bool sameRect(const Glyph& a, const Glyph& b) {
+    return a.u1 == b.u1 && a.v1 == b.v1 && a.u2 == b.u2 && a.v2 == b.v2 &&
+        a.offset == b.offset && a.size == b.size;
+}
+
+// AtlasGlyph data of glyphs that were not evicted stays valid
+static void checkValid(const GlyphAtlas& _atlas, const Textures& _textures,
+                       const std::vector<Tracked>& _live) {
+    for (auto& t : _live) {
+        CHECK(_atlas.glyphVersion(t.entry.index) == t.version);
+        CHECK(sameRect(*t.entry.glyph, t.glyph));
+        CHECK(_textures.pixels(t.entry) == t.pixels);
+    }
+}
+
+int main() {
+    FreetypeHelper ft;
+    InputSource source(testFont());
+
+    auto font = std::make_shared<Font>(Font::Properties(64));
+    auto face = std::make_shared<FontFace>(ft, 0, FontFace::Descriptor(source), 64);
+    face->load();
+    font->addFace(face);
+
+    Textures textures;
+    GlyphAtlas atlas(textures, 128);
+    atlas.setMaxAtlases(2);
+
+    struct Eviction {
+        AtlasID atlas;
+        std::vector<GlyphKey> keys;
+    };
+    std::vector<Eviction> evictions;
+    atlas.setEvictionCallback([&](AtlasID id, const std::vector<GlyphKey>& keys) {
+        evictions.push_back({ id, keys });
+    });
+
+    std::vector<Tracked> live;
+    uint32_t pageUsed[2] = { 0, 0 };
+
+    // One glyph per frame, all letters twice
+    for (uint32_t i = 0; i < 104; i++) {
+        atlas.advanceFrame();
+
+        GlyphKey key(0, 2 + i % 52);
+        auto found = std::find_if(live.begin(), live.end(),
+                                  [&](const Tracked& t) { return t.key == key; });
+
+        // Least recently used page
+        AtlasID lru = textures.pages.size() < 2 ? 2 : pageUsed[0] <= pageUsed[1] ? 0 : 1;
+
+        size_t count = evictions.size();
+        AtlasGlyph entry;
+        CHECK(atlas.getGlyph(*font, key, entry));
+        if (entry.atlas < 2) { pageUsed[entry.atlas] = atlas.frame(); }
+
+        if (found != live.end()) {
+            // Same Glyph
+            CHECK(evictions.size() == count);
+            CHECK(entry.glyph == found->entry.glyph && entry.index == found->entry.index);
+            checkValid(atlas, textures, live);
+            continue;
+        }
+
+        if (evictions.size() != count) {
+            CHECK(evictions.size() == count + 1);
+            auto& eviction = evictions.back();
+            CHECK(eviction.atlas == lru);
+
+            // Keys are the glyphs of the page, their data is invalid
+            std::vector<GlyphKey> keys;
+            for (auto it = live.begin(); it != live.end();) {
+                if (it->entry.atlas != eviction.atlas) {
+                    ++it;
+                    continue;
+                }
+                keys.push_back(it->key);
+                CHECK(atlas.glyphVersion(it->entry.index) != it->version);
+
+                AtlasGlyph old;
+                CHECK(!atlas.findGlyph(it->key, old));
+                it = live.erase(it);
+            }
+            CHECK(keys.size() == eviction.keys.size());
+            for (auto& k : keys) {
+                CHECK(std::find(eviction.keys.begin(), eviction.keys.end(), k) !=
+                      eviction.keys.end());
+            }
+
+            // The page is recycled for the new glyph and was cleared
+            CHECK(entry.atlas == eviction.atlas);
+            auto& page = textures.pages[entry.atlas];
+            auto& g = *entry.glyph;
+            for (int y = 0; y < page.height; y++) {
+                for (int x = 0; x < page.width; x++) {
+                    if (x >= g.u1 && x < g.u2 && y >= g.v1 && y < g.v2) { continue; }
+                    CHECK(page.pixels[y * page.width + x] == 0);
+                }
+            }
+        }
+        checkValid(atlas, textures, live);
+
+        live.push_back({ key, entry, atlas.glyphVersion(entry.index), *entry.glyph,
+                         textures.pixels(entry) });
+    }
+
+    CHECK(evictions.size() > 2);
+    CHECK(textures.pages.size() == 2 && textures.added == 2);
+
+    // Glyphs used in the current frame keep their page
+    atlas.advanceFrame();
+    AtlasID keep = live.back().entry.atlas;
+    AtlasID other = 1 - keep;
+    CHECK(std::any_of(live.begin(), live.end(),
+                      [&](const Tracked& t) { return t.entry.atlas == other; }));
+
+    for (auto& t : live) {
+        AtlasGlyph entry;
+        if (t.entry.atlas == keep) {
+            CHECK(atlas.findGlyph(t.key, entry) && entry.glyph == t.entry.glyph);
+        }
+    }
+
+    size_t count = evictions.size();
+    CHECK(atlas.evict(0) == 1);
+    CHECK(evictions.size() == count + 1 && evictions.back().atlas == other);
+
+    live.erase(std::remove_if(live.begin(), live.end(),
+                              [&](const Tracked& t) { return t.entry.atlas == other; }),
+               live.end());
+    checkValid(atlas, textures, live);
+
+    // Empty pages are not evicted, nor pages used within @frames
+    CHECK(atlas.evict(0) == 0);
+    atlas.advanceFrame();
+    atlas.advanceFrame();
+    CHECK(atlas.evict(2) == 0);
+    checkValid(atlas, textures, live);
+
+    atlas.advanceFrame();
+    CHECK(atlas.evict(2) == 1);
+    CHECK(evictions.size() == count + 2 && evictions.back().atlas == keep);
+    CHECK(evictions.back().keys.size() == live.size());
+
+    for (auto& t : live) {
+        AtlasGlyph entry;
+        CHECK(!atlas.findGlyph(t.key, entry));
+        CHECK(atlas.glyphVersion(t.entry.index) != t.version);
+    }
+    CHECK(textures.added == 2);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// Atlas::addRect() places random rects where the plain skyline bottom-left
+// search does, without overlaps and inside the page, also after expand().
+
+#include "alfons/atlas.h"
+#include "test.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace alfons;
+
+// Skyline packer without the early outs of Atlas
+struct Reference {
+    struct Node {
+        int x, y, width;
+    };
+    int width, height;
+    std::vector<Node> nodes;
+
+    Reference(int w, int h) : width(w), height(h), nodes{ { 0, 0, w } } {}
+
+    void expand(int w, int h) {
+        if (w > width) { nodes.push_back({ width, 0, w - width }); }
+        width = w;
+        height = h;
+        merge();
+    }
+
+    int fits(size_t i, int w, int h) const {
+        if (nodes[i].x + w > width) { return -1; }
+        int y = nodes[i].y;
+        for (int left = w; left > 0; left -= nodes[i++].width) {
+            if (i == nodes.size()) { return -1; }
+            y = std::max(y, nodes[i].y);
+            if (y + h > height) { return -1; }
+        }
+        return y;
+    }
+
+    bool addRect(int w, int h, int* rx, int* ry) {
+        int besth = height, bestw = width, besti = -1;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            int y = fits(i, w, h);
+            if (y == -1) { continue; }
+            if (y + h < besth || (y + h == besth && nodes[i].width < bestw)) {
+                besti = int(i);
+                bestw = nodes[i].width;
+                besth = y + h;
+                *rx = nodes[i].x;
+                *ry = y;
+            }
+        }
+        if (besti == -1) { return false; }
+
+        nodes.insert(nodes.begin() + besti, { *rx, *ry + h, w });
+        for (size_t i = besti + 1; i < nodes.size();) {
+            int shrink = nodes[i - 1].x + nodes[i - 1].width - nodes[i].x;
+            if (shrink <= 0) { break; }
+            if (nodes[i].width > shrink) {
+                nodes[i].x += shrink;
+                nodes[i].width -= shrink;
+                break;
+            }
+            nodes.erase(nodes.begin() + i);
+        }
+        merge();
+        return true;
+    }
+
+    void merge() {
+        for (size_t i = 0; i + 1 < nodes.size();) {
+            if (nodes[i].y == nodes[i + 1].y) {
+                nodes[i].width += nodes[i + 1].width;
+                nodes.erase(nodes.begin() + i + 1);
+            } else {
+                i++;
+            }
+        }
+    }
+};
+
+struct Placed {
+    int x, y, w, h;
+};
+
+static bool overlaps(const Placed& a, const Placed& b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+static void testRandom(std::mt19937& _rng, int _maxSize, bool _expand) {
+    Atlas atlas(128, 128);
+    Reference reference(128, 128);
+    std::vector<Placed> placed;
+
+    for (int i = 0; i < 2000; i++) {
+        if (_expand && i == 300) {
+            atlas.expand(256, 256);
+            reference.expand(256, 256);
+        }
+        int w = 1 + _rng() % _maxSize;
+        int h = 1 + _rng() % _maxSize;
+
+        int x = -1, y = -1, rx = -1, ry = -1;
+        bool added = atlas.addRect(w, h, &x, &y);
+        bool expected = reference.addRect(w, h, &rx, &ry);
+
+        CHECK(added == expected);
+        if (!added || !expected) { continue; }
+        CHECK(x == rx && y == ry);
+
+        Placed rect{ x, y, w, h };
+        CHECK(x >= 0 && y >= 0 && x + w <= atlas.width && y + h <= atlas.height);
+        for (auto& other : placed) { CHECK(!overlaps(rect, other)); }
+        placed.push_back(rect);
+    }
+
+    // Skyline segments cover the page without gaps
+    int x = 0;
+    for (auto& node : atlas.nodes) {
+        CHECK(node.x == x);
+        CHECK(node.width > 0);
+        x += node.width;
+    }
+    CHECK(x == atlas.width);
+}
+
+int main() {
+    std::mt19937 rng(1);
+
+    for (int round = 0; round < 20; round++) {
+        testRandom(rng, 24, false);
+        testRandom(rng, 48, true);
+    }
+
+    // Rects larger than the space left do not fit
+    Atlas atlas(64, 64);
+    int x, y;
+    CHECK(!atlas.addRect(65, 1, &x, &y));
+    CHECK(!atlas.addRect(1, 65, &x, &y));
+    CHECK(atlas.addRect(64, 60, &x, &y));
+    CHECK(!atlas.addRect(1, 5, &x, &y));
+    CHECK(atlas.addRect(1, 3, &x, &y));
+    CHECK(x == 0 && y == 60);
+
+    return TEST_RESULT();
+}
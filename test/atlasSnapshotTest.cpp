@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// GlyphAtlas::snapshot() round trips through restore() and save()/load(),
+// and restore() of truncated and corrupted snapshots.
+
+#include "alfons/atlas.h"
+#include "alfons/font.h"
+#include "test.h"
+#include "testFont.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace alfons;
+
+// Keeps the uploaded pixels of each page
+struct Textures : TextureCallback {
+    struct Page {
+        uint16_t width, height;
+        std::vector<unsigned char> pixels;
+    };
+    std::vector<Page> pages;
+    size_t uploads = 0;
+
+    void addTexture(AtlasID id, uint16_t w, uint16_t h) override {
+        if (pages.size() <= id) { pages.resize(id + 1); }
+        pages[id] = { w, h, std::vector<unsigned char>(w * h) };
+    }
+    void addGlyph(AtlasID id, uint16_t gx, uint16_t gy, uint16_t gw, uint16_t gh,
+                  const unsigned char* src, uint16_t padding) override {
+        auto& page = pages[id];
+        for (int y = 0; y < gh; y++) {
+            memcpy(&page.pixels[(gy + padding + y) * page.width + gx + padding],
+                   src + y * gw, gw);
+        }
+        uploads++;
+    }
+};
+
+static std::shared_ptr<Font> makeFont(FreetypeHelper& _ft, const InputSource& _source,
+                                      FaceID _id, float _size) {
+    auto font = std::make_shared<Font>(Font::Properties(_size));
+    auto face = std::make_shared<FontFace>(_ft, _id, FontFace::Descriptor(_source), _size);
+    face->load();
+    font->addFace(face);
+    return font;
+}
+
+// Layout of the snapshot format: 32 byte header, then per page a 16 byte
+// header, 16 byte nodes and the pixels. Glyph records of 48 bytes follow.
+const size_t headerSize = 32;
+const size_t glyphSize = 48;
+
+static void put(std::vector<char>& _data, size_t _offset, uint32_t _value) {
+    memcpy(&_data[_offset], &_value, sizeof(_value));
+}
+
+static void put16(std::vector<char>& _data, size_t _offset, uint16_t _value) {
+    memcpy(&_data[_offset], &_value, sizeof(_value));
+}
+
+static bool restores(const std::vector<char>& _data) {
+    Textures textures;
+    GlyphAtlas atlas(textures, 256);
+    return atlas.restore(_data.data(), _data.size());
+}
+
+int main() {
+    FreetypeHelper ft;
+    InputSource source(testFont());
+
+    const uint32_t first = 2, count = 52;
+
+    Textures textures;
+    GlyphAtlas atlas(textures, 256);
+    auto font = makeFont(ft, source, 0, 40);
+
+    std::vector<AtlasGlyph> glyphs(count);
+    for (uint32_t i = 0; i < count; i++) {
+        CHECK(atlas.getGlyph(*font, { 0, first + i }, glyphs[i]));
+    }
+
+    auto data = atlas.snapshot();
+    CHECK(data.size() % 8 == 0);
+
+    // Round trip with a face of another FaceID
+    {
+        Textures restoredTextures;
+        GlyphAtlas restored(restoredTextures, 256);
+        CHECK(restored.restore(data.data(), data.size()));
+
+        // One upload per page with the same pixels
+        CHECK(restoredTextures.pages.size() == textures.pages.size());
+        CHECK(restoredTextures.uploads == restoredTextures.pages.size());
+        for (size_t i = 0; i < textures.pages.size() && i < restoredTextures.pages.size(); i++) {
+            CHECK(restoredTextures.pages[i].pixels == textures.pages[i].pixels);
+        }
+
+        // Restored glyphs are used instead of rendering them again
+        auto other = makeFont(ft, source, 5, 40);
+        for (uint32_t i = 0; i < count; i++) {
+            AtlasGlyph entry;
+            CHECK(restored.getGlyph(*other, { 5, first + i }, entry));
+            CHECK(entry.atlas == glyphs[i].atlas);
+
+            auto& a = *entry.glyph;
+            auto& b = *glyphs[i].glyph;
+            CHECK(a.u1 == b.u1 && a.v1 == b.v1 && a.u2 == b.u2 && a.v2 == b.v2);
+            CHECK(a.offset == b.offset && a.size == b.size);
+        }
+        CHECK(restoredTextures.uploads == restoredTextures.pages.size());
+
+        // Other sizes are rendered
+        auto larger = makeFont(ft, source, 6, 41);
+        AtlasGlyph entry;
+        CHECK(restored.getGlyph(*larger, { 6, first }, entry));
+        CHECK(restoredTextures.uploads == restoredTextures.pages.size() + 1);
+
+        // Only into empty atlases
+        CHECK(!restored.restore(data.data(), data.size()));
+    }
+
+    // Through a file
+    {
+        const char* path = "atlasSnapshotTest.bin";
+        CHECK(atlas.save(path));
+
+        Textures restoredTextures;
+        GlyphAtlas restored(restoredTextures, 256);
+        CHECK(restored.load(path));
+        CHECK(restoredTextures.pages.size() == textures.pages.size());
+        std::remove(path);
+
+        GlyphAtlas missing(restoredTextures, 256);
+        CHECK(!missing.load(path));
+    }
+
+    // Other atlas settings
+    {
+        Textures restoredTextures;
+        GlyphAtlas padded(restoredTextures, 256, 2);
+        CHECK(!padded.restore(data.data(), data.size()));
+    }
+
+    // Truncated at every field of the header and the first page header,
+    // then at steps through pixels and glyphs
+    for (size_t size = 0; size < data.size(); size += size < 64 ? 1 : 997) {
+        CHECK(!restores(std::vector<char>(data.begin(), data.begin() + size)));
+    }
+    CHECK(!restores(std::vector<char>(data.begin(), data.end() - 1)));
+    CHECK(!restores(std::vector<char>(data.begin(), data.end() - glyphSize)));
+    CHECK(restores(data));
+
+    // Bad page sizes
+    {
+        const size_t page = headerSize;
+        const uint32_t values[][4] = {
+            { 0, 256, 1, 1 },            // no width
+            { 256, 0, 1, 1 },            // no height
+            { 1u << 30, 256, 1, 1 },     // larger than textures
+            { 256, 0xffffffff, 1, 1 },
+            { 512, 512, 1, 1 },          // more pixels than data
+            { 256, 256, 2, 1 },          // unknown format
+            { 256, 256, 1, 0 },          // no skyline
+            { 256, 256, 1, 257 },        // more nodes than pixels in width
+        };
+        for (auto& v : values) {
+            auto bad = data;
+            for (int i = 0; i < 4; i++) { put(bad, page + i * 4, v[i]); }
+            CHECK(!restores(bad));
+        }
+
+        // Skyline nodes past the page, out of order or with gaps
+        const size_t node = page + 16;
+        auto bad = data;
+        put(bad, node + 8, 257);
+        CHECK(!restores(bad));
+
+        bad = data;
+        put(bad, node, 1);
+        CHECK(!restores(bad));
+
+        bad = data;
+        put(bad, node, 1);
+        put(bad, node + 8, 255);
+        CHECK(!restores(bad));
+
+        bad = data;
+        put(bad, node + 8, 255);
+        CHECK(!restores(bad));
+
+        bad = data;
+        put(bad, node + 4, 257);
+        CHECK(!restores(bad));
+
+        // More pages than data
+        bad = data;
+        put(bad, 8, 1000);
+        CHECK(!restores(bad));
+    }
+
+    // Out of range glyph rects
+    {
+        const size_t glyph = data.size() - glyphSize;
+        const size_t page = glyph + 20;
+        const size_t rect = glyph + 24;
+
+        auto bad = data;
+        put(bad, page, uint32_t(textures.pages.size()));
+        CHECK(!restores(bad));
+
+        bad = data;
+        put16(bad, rect + 4, 257);
+        CHECK(!restores(bad));
+
+        bad = data;
+        put16(bad, rect + 6, 257);
+        CHECK(!restores(bad));
+
+        // Inverted
+        bad = data;
+        put16(bad, rect, 200);
+        put16(bad, rect + 4, 100);
+        CHECK(!restores(bad));
+
+        bad = data;
+        float nan = NAN;
+        memcpy(&bad[glyph + 40], &nan, sizeof(nan));
+        CHECK(!restores(bad));
+
+        // At the page border
+        bad = data;
+        put16(bad, rect, 250);
+        put16(bad, rect + 4, 256);
+        CHECK(restores(bad));
+    }
+
+    // More glyphs than data
+    auto bad = data;
+    put(bad, 12, 0xffffffff);
+    CHECK(!restores(bad));
+
+    return TEST_RESULT();
+}
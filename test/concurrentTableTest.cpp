@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// ConcurrentTable lookups across growth, duplicate inserts and
+// insertion order of forEach().
+
+#include "alfons/concurrentTable.h"
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+using namespace alfons;
+
+int main() {
+    ConcurrentTable<std::string, int> table;
+
+    CHECK(table.find("a") == nullptr);
+    CHECK(table.size() == 0);
+
+    // Grows several times from 16 slots
+    const int count = 5000;
+    for (int i = 0; i < count; i++) {
+        const int& value = table.insert(std::to_string(i), i);
+        CHECK(value == i);
+
+        // Values keep their address when the slots grow
+        CHECK(table.find("0") != nullptr && *table.find("0") == 0);
+    }
+    CHECK(table.size() == size_t(count));
+
+    for (int i = 0; i < count; i++) {
+        auto value = table.find(std::to_string(i));
+        CHECK(value != nullptr && *value == i);
+    }
+    CHECK(table.find(std::to_string(count)) == nullptr);
+
+    // Existing keys keep their value
+    CHECK(table.insert("7", -1) == 7);
+    CHECK(table.size() == size_t(count));
+
+    std::vector<int> order;
+    table.forEach([&](const std::string& key, int value) {
+        CHECK(key == std::to_string(value));
+        order.push_back(value);
+    });
+    CHECK(order.size() == size_t(count));
+    for (size_t i = 0; i < order.size(); i++) { CHECK(order[i] == int(i)); }
+
+    return TEST_RESULT();
+}
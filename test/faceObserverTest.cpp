@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// GlyphAtlas and GlyphRasterizer entries of faces that are unloaded and
+// destroyed, with shared and separate glyphs.
+
+#include "alfons/atlas.h"
+#include "alfons/font.h"
+#include "test.h"
+#include "testFont.h"
+
+using namespace alfons;
+
+struct Textures : TextureCallback {
+    void addTexture(AtlasID, uint16_t, uint16_t) override {}
+    void addGlyph(AtlasID, uint16_t, uint16_t, uint16_t, uint16_t, const unsigned char*,
+                  uint16_t) override {}
+};
+
+static std::shared_ptr<Font> makeFont(FreetypeHelper& _ft, const InputSource& _source,
+                                      FaceID _id, float _size) {
+    auto font = std::make_shared<Font>(Font::Properties(_size));
+    auto face = std::make_shared<FontFace>(_ft, _id, FontFace::Descriptor(_source), _size);
+    face->load();
+    font->addFace(face);
+    return font;
+}
+
+int main() {
+    FreetypeHelper ft;
+    InputSource source(testFont());
+    Textures textures;
+
+    const uint32_t a = 2, b = 3;
+
+    // Separate glyphs per face
+    {
+        GlyphRasterizer rasterizer(2);
+        GlyphAtlas atlas(textures, 256);
+        atlas.setRasterizer(&rasterizer);
+
+        auto font = makeFont(ft, source, 0, 20);
+        auto& face = const_cast<FontFace&>(*font->faces()[0]);
+
+        AtlasGlyph entry;
+        CHECK(atlas.getGlyph(*font, { 0, a }, entry));
+        uint32_t index = entry.index;
+        uint32_t version = atlas.glyphVersion(index);
+
+        // Unloading keeps the glyphs, new ones render after load()
+        face.unload();
+        CHECK(atlas.findGlyph({ 0, a }, entry));
+        CHECK(face.load());
+        CHECK(atlas.getGlyph(*font, { 0, b }, entry));
+
+        // A new face with the same FaceID must not find the old glyphs
+        font.reset();
+        CHECK(!atlas.findGlyph({ 0, a }, entry));
+        CHECK(atlas.glyphVersion(index) != version);
+
+        font = makeFont(ft, source, 0, 30);
+        CHECK(atlas.getGlyph(*font, { 0, a }, entry));
+        CHECK(entry.glyph->size.y > 0);
+    }
+
+    // Shared glyphs move to the remaining face of the font
+    {
+        GlyphAtlas atlas(textures, 256);
+        atlas.setSizeBuckets(4);
+
+        auto font1 = makeFont(ft, source, 1, 20);
+        auto font2 = makeFont(ft, source, 2, 19);
+
+        AtlasGlyph entry1, entry2;
+        CHECK(atlas.getGlyph(*font1, { 1, a }, entry1));
+        CHECK(atlas.getGlyph(*font2, { 2, a }, entry2));
+        CHECK(entry1.glyph == entry2.glyph);
+
+        font1.reset();
+        CHECK(!atlas.findGlyph({ 1, a }, entry1));
+        CHECK(atlas.findGlyph({ 2, a }, entry2));
+
+        // Rendered with the remaining face
+        CHECK(atlas.getGlyph(*font2, { 2, b }, entry2));
+        uint32_t index = entry2.index;
+        uint32_t version = atlas.glyphVersion(index);
+
+        font2.reset();
+        CHECK(!atlas.findGlyph({ 2, b }, entry2));
+        CHECK(atlas.glyphVersion(index) != version);
+    }
+
+    // Rasterizers and atlases that go before the face
+    auto font = makeFont(ft, source, 3, 20);
+    {
+        GlyphRasterizer rasterizer(1);
+        GlyphAtlas atlas(textures, 256);
+        atlas.setRasterizer(&rasterizer);
+        atlas.setSizeBuckets(4);
+
+        AtlasGlyph entry;
+        CHECK(atlas.getGlyph(*font, { 3, a }, entry));
+    }
+    const_cast<FontFace&>(*font->faces()[0]).unload();
+    font.reset();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// GlyphBitmap::scale() down and up, and the bitmap strike selection of
+// FontFace::openFace().
+
+#include "alfons/freetypeHelper.h"
+#include "test.h"
+
+using namespace alfons;
+
+static GlyphBitmap bitmap(int _x0, int _y0, int _w, int _h, int _channels,
+                          std::vector<unsigned char> _pixels) {
+    GlyphBitmap b;
+    b.x0 = _x0;
+    b.y0 = _y0;
+    b.x1 = _x0 + _w;
+    b.y1 = _y0 + _h;
+    b.channels = _channels;
+    b.buffer = std::move(_pixels);
+    return b;
+}
+
+static int strike(std::vector<int> _ppems, float _size) {
+    std::vector<FT_Bitmap_Size> sizes(_ppems.size());
+    for (size_t i = 0; i < sizes.size(); i++) { sizes[i].y_ppem = _ppems[i] * 64; }
+    return selectStrike(sizes.data(), int(sizes.size()), _size);
+}
+
+int main() {
+    // Smallest strike not smaller than the size, in any order
+    CHECK(strike({ 40, 20, 160, 80 }, 30) == 0);
+    CHECK(strike({ 40, 20, 160, 80 }, 40) == 0);
+    CHECK(strike({ 40, 20, 160, 80 }, 41) == 3);
+    CHECK(strike({ 40, 20, 160, 80 }, 10) == 1);
+    CHECK(strike({ 40, 20, 160, 80 }, 100) == 2);
+    // Else the largest one
+    CHECK(strike({ 40, 20, 160, 80 }, 200) == 2);
+    CHECK(strike({ 109 }, 20) == 0);
+
+    // Downscaling averages blocks
+    {
+        auto b = bitmap(4, -8, 4, 2, 1, { 0, 100, 200, 200,
+                                          100, 200, 40, 40 });
+        b.scale(0.5f);
+        CHECK(b.x0 == 2 && b.y0 == -4 && b.width() == 2 && b.height() == 1);
+        CHECK(b.buffer.size() == 2);
+        CHECK(b.buffer[0] == 100 && b.buffer[1] == 120);
+    }
+
+    // Upscaling keeps constant areas and edge pixels, interpolates between
+    {
+        auto b = bitmap(-1, -2, 2, 2, 4, { 0, 0, 0, 0,     200, 100, 50, 255,
+                                           0, 0, 0, 0,     200, 100, 50, 255 });
+        b.scale(2);
+        CHECK(b.x0 == -2 && b.y0 == -4 && b.width() == 4 && b.height() == 4);
+        CHECK(b.buffer.size() == 4 * 4 * 4);
+
+        for (int y = 0; y < 4; y++) {
+            auto row = &b.buffer[y * 16];
+            CHECK(row[0] == 0 && row[3] == 0);
+            CHECK(row[12] == 200 && row[13] == 100 && row[14] == 50 && row[15] == 255);
+            // Quarter and three quarters of the way
+            CHECK(row[4] == 50 && row[7] == 64);
+            CHECK(row[8] == 150 && row[11] == 191);
+        }
+    }
+
+    // Non-integer factors reach the rounded size
+    {
+        auto b = bitmap(0, 0, 3, 5, 1, std::vector<unsigned char>(15, 77));
+        b.scale(1.5f);
+        CHECK(b.width() == 5 && b.height() == 8);
+        for (auto v : b.buffer) { CHECK(v == 77); }
+
+        b.scale(0.3f);
+        CHECK(b.width() == 2 && b.height() == 2);
+        for (auto v : b.buffer) { CHECK(v == 77); }
+    }
+
+    return TEST_RESULT();
+}
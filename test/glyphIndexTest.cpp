@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// Random insert, erase and find on GlyphIndex against std::unordered_map
+
+#include "alfons/glyphIndex.h"
+#include "test.h"
+
+#include <random>
+#include <unordered_map>
+
+using namespace alfons;
+
+int main() {
+    std::mt19937 rng(1);
+
+    GlyphIndex index;
+    std::unordered_map<uint64_t, uint32_t> reference;
+
+    for (uint32_t i = 0; i < 500000; i++) {
+        // Few fonts and neighboring glyph ids, as in an atlas
+        uint64_t key = uint64_t(rng() % 8) << 32 | (rng() % 5000);
+
+        switch (rng() % 3) {
+        case 0:
+            index.insert(key, i);
+            reference[key] = i;
+            break;
+        case 1:
+            CHECK(index.erase(key) == (reference.erase(key) != 0));
+            break;
+        default: {
+            auto it = reference.find(key);
+            uint32_t value = index.find(key);
+            CHECK(it == reference.end() ? value == GlyphIndex::npos : value == it->second);
+        }
+        }
+        if (testFailures) { break; }
+    }
+
+    CHECK(index.size() == reference.size());
+
+    for (auto& entry : reference) { CHECK(index.find(entry.first) == entry.second); }
+
+    index.clear();
+    CHECK(index.size() == 0);
+    CHECK(index.find(reference.begin()->first) == GlyphIndex::npos);
+
+    return TEST_RESULT();
+}
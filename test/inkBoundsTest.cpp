@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// inkBounds() boxes against the rects TextBatch::draw() emits for the same
+// layout, with forced line breaks and for wrapped lines.
+
+#include "alfons/atlas.h"
+#include "alfons/fontManager.h"
+#include "alfons/inkBounds.h"
+#include "alfons/textBatch.h"
+#include "test.h"
+#include "testFont.h"
+
+#include <algorithm>
+
+using namespace alfons;
+
+struct Textures : TextureCallback {
+    void addTexture(AtlasID, uint16_t, uint16_t) override {}
+    void addGlyph(AtlasID, uint16_t, uint16_t, uint16_t, uint16_t, const unsigned char*,
+                  uint16_t) override {}
+};
+
+struct Rects {
+    std::vector<Rect> rects;
+    void drawGlyph(const Quad&, const AtlasGlyph&) {}
+    void drawGlyph(const Rect& rect, const AtlasGlyph&) { rects.push_back(rect); }
+};
+
+// Boxes of glyphs with ink must lie in the drawn rect, which is larger
+// by at most a pixel of rounding and the glyph padding on each side
+static void compare(const LineLayout& _line, const std::vector<Rect>& _boxes,
+                    const std::vector<Rect>& _drawn, const Rect& _bounds) {
+    const float slack = 2.f * _line.scale() + 1e-3f;
+
+    size_t k = 0;
+    Rect all = { 1e9f, 1e9f, -1e9f, -1e9f };
+
+    for (size_t i = 0; i < _boxes.size(); i++) {
+        auto& box = _boxes[i];
+        if (box.x1 == box.x2) { continue; }
+
+        CHECK(k < _drawn.size());
+        if (k >= _drawn.size()) { return; }
+        auto& rect = _drawn[k++];
+
+        CHECK(box.x1 >= rect.x1 - 1e-3f && box.y1 >= rect.y1 - 1e-3f);
+        CHECK(box.x2 <= rect.x2 + 1e-3f && box.y2 <= rect.y2 + 1e-3f);
+        CHECK(box.x1 - rect.x1 <= slack && box.y1 - rect.y1 <= slack);
+        CHECK(rect.x2 - box.x2 <= slack && rect.y2 - box.y2 <= slack);
+
+        all = { std::min(all.x1, box.x1), std::min(all.y1, box.y1),
+                std::max(all.x2, box.x2), std::max(all.y2, box.y2) };
+    }
+    CHECK(k == _drawn.size());
+    CHECK(all.x1 == _bounds.x1 && all.y1 == _bounds.y1);
+    CHECK(all.x2 == _bounds.x2 && all.y2 == _bounds.y2);
+}
+
+int main() {
+    FontManager fontManager;
+    auto font = fontManager.addFont("test", Font::Properties(20), InputSource(testFont()));
+    auto& face = const_cast<FontFace&>(*font->faces()[0]);
+    CHECK(face.load());
+
+    // Words of boxes, spaces that allow breaks and two forced breaks
+    const char* text = "Hello world\nfoo Bar\nbaz QUUX";
+    std::vector<Shape> shapes;
+    for (const char* c = text; *c; c++) {
+        uint32_t glyph = face.getCodepoint(*c == '\n' ? ' ' : *c);
+        Shape shape(face.id(), glyph, glm::vec2(0, 0),
+                    testGlyphBox(glyph).advance * face.size() / 1000.f, 0);
+        shape.cluster = true;
+        shape.isSpace = *c == ' ' || *c == '\n';
+        shape.canBreak = shape.isSpace;
+        shape.mustBreak = *c == '\n';
+        shapes.push_back(shape);
+    }
+
+    LineLayout line(font, shapes, face.metrics(), HB_DIRECTION_LTR);
+    line.setScale(1.5f);
+    CHECK(line.height() > 0);
+
+    Textures textures;
+    GlyphAtlas atlas(textures, 256);
+
+    // Forced breaks
+    {
+        Rect bounds;
+        std::vector<Rect> boxes;
+        CHECK(inkBounds(line, { 10, 40 }, bounds, 0, &boxes));
+        CHECK(boxes.size() == shapes.size());
+
+        Rects drawn;
+        BasicTextBatch<Rects> batch(atlas, drawn);
+        batch.draw(line, { 10, 40 });
+
+        compare(line, boxes, drawn.rects, bounds);
+
+        // Three lines
+        CHECK(bounds.y2 - bounds.y1 > 2 * line.height());
+    }
+
+    // Wrapped lines
+    {
+        auto lines = wrap(line, 60);
+        CHECK(lines.size() > 3);
+
+        Rect bounds;
+        std::vector<Rect> boxes;
+        CHECK(inkBounds(line, lines, { 0, 0 }, bounds, 0, &boxes));
+
+        Rects drawn;
+        BasicTextBatch<Rects> batch(atlas, drawn);
+        batch.draw(line, lines, { 0, 0 });
+
+        compare(line, boxes, drawn.rects, bounds);
+    }
+
+    // Halo grows the bounds
+    Rect bounds, halo;
+    inkBounds(line, { 0, 0 }, bounds);
+    inkBounds(line, { 0, 0 }, halo, 3);
+    CHECK(halo.x1 == bounds.x1 - 3 && halo.y2 == bounds.y2 + 3);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// Prefix queries of LineLayout (rangeAdvance, fitShapes, breaks) against
+// loops over the shapes, also after removeShapes() and setScale().
+
+#include "alfons/lineLayout.h"
+#include "test.h"
+
+#include <random>
+#include <vector>
+
+using namespace alfons;
+
+static float loopAdvance(const LineLayout& _line, size_t _start, size_t _end) {
+    float advance = 0;
+    for (size_t i = _start; i < _end; i++) { advance += _line.advance(_line.shapes()[i]); }
+    return advance;
+}
+
+static size_t loopFit(const LineLayout& _line, size_t _start, float _width) {
+    size_t n = 0;
+    while (_start + n < _line.shapes().size() &&
+           loopAdvance(_line, _start, _start + n + 1) <= _width) {
+        n++;
+    }
+    return n;
+}
+
+static void checkQueries(std::mt19937& _rng, const LineLayout& _line) {
+    auto& shapes = _line.shapes();
+    size_t count = shapes.size();
+
+    CHECK(_line.advance() == loopAdvance(_line, 0, count));
+
+    for (int i = 0; i < 20 && count > 0; i++) {
+        size_t start = _rng() % count;
+        size_t end = start + _rng() % (count - start + 1);
+        CHECK(_line.rangeAdvance(start, end) == loopAdvance(_line, start, end));
+
+        float width = float(_rng() % 300);
+        CHECK(_line.fitShapes(start, width) == loopFit(_line, start, width));
+    }
+    CHECK(_line.fitShapes(count, 100) == 0);
+
+    std::vector<uint32_t> breaks, mustBreaks;
+    for (size_t i = 0; i < count; i++) {
+        if (!shapes[i].cluster) { continue; }
+        if (shapes[i].canBreak || shapes[i].mustBreak) { breaks.push_back(uint32_t(i + 1)); }
+        if (shapes[i].mustBreak) { mustBreaks.push_back(uint32_t(i + 1)); }
+    }
+    CHECK(_line.breaks() == breaks);
+    CHECK(_line.mustBreaks() == mustBreaks);
+}
+
+int main() {
+    std::mt19937 rng(5);
+
+    for (int i = 0; i < 2000; i++) {
+        // Whole pixel advances and scales of multiples of 1/2 sum exactly
+        std::vector<Shape> shapes;
+        int count = rng() % 80;
+        for (int j = 0; j < count; j++) {
+            Shape shape(0, 65, glm::vec2(0, 0), float(rng() % 20), 0);
+            shape.cluster = rng() % 8 != 0;
+            shape.canBreak = rng() % 6 == 0;
+            shape.mustBreak = rng() % 25 == 0;
+            shapes.push_back(shape);
+        }
+
+        LineLayout line(nullptr);
+        line.addShapes(shapes);
+        line.setScale(0.5f * (1 + rng() % 4));
+        checkQueries(rng, line);
+
+        if (count > 0) {
+            size_t start = rng() % count;
+            size_t end = start + rng() % (count - start + 1);
+            line.removeShapes(start, end);
+            checkQueries(rng, line);
+        }
+
+        line.setScale(0.5f * (1 + rng() % 4));
+        checkQueries(rng, line);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// wrap() and wrapTrials() of random shape sequences against the linear
+// scan that TextBatch::draw(line, position, width) used before.
+
+#include "alfons/lineWrap.h"
+#include "test.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace alfons;
+
+// Advances are whole pixels and scales multiples of 1/2, so sums are exact
+static LineLayout randomLine(std::mt19937& _rng) {
+    std::vector<Shape> shapes;
+    int count = _rng() % 80;
+
+    for (int i = 0; i < count; i++) {
+        bool space = _rng() % 6 == 0;
+        Shape shape(0, space ? 32 : 65, glm::vec2(0, 0), float(_rng() % 20), 0);
+        shape.cluster = _rng() % 8 != 0;
+        shape.isSpace = space;
+        shape.canBreak = space || _rng() % 10 == 0;
+        shape.mustBreak = _rng() % 25 == 0;
+        shapes.push_back(shape);
+    }
+
+    LineLayout line(nullptr);
+    line.addShapes(shapes);
+    line.setScale(0.5f * (1 + _rng() % 4));
+    return line;
+}
+
+static float rangeAdvance(const LineLayout& _line, size_t _start, size_t _end) {
+    auto& shapes = _line.shapes();
+    if (_end > _start && shapes[_end - 1].isSpace) { _end--; }
+
+    float advance = 0;
+    for (size_t i = _start; i < _end; i++) { advance += _line.advance(shapes[i]); }
+    return advance;
+}
+
+static std::vector<LineRange> reference(const LineLayout& _line, float _width) {
+    std::vector<LineRange> lines;
+    auto& shapes = _line.shapes();
+
+    float lineWidth = 0;
+    float lastWidth = 0;
+    size_t lastShape = 0;
+    size_t startShape = 0;
+
+    for (size_t i = 0; i < shapes.size(); i++) {
+        auto& shape = shapes[i];
+        lineWidth += _line.advance(shape);
+
+        if (!shape.cluster) { continue; }
+
+        if (shape.canBreak || shape.mustBreak) {
+            lastShape = i + 1;
+            lastWidth = lineWidth;
+        }
+
+        if (lastShape != 0 && (lineWidth > _width || shape.mustBreak)) {
+            auto& endShape = shapes[lastShape - 1];
+            if (endShape.isSpace) {
+                lineWidth -= _line.advance(endShape);
+                lastWidth -= _line.advance(endShape);
+            }
+            lines.push_back({ startShape, lastShape, rangeAdvance(_line, startShape, lastShape) });
+
+            lineWidth -= lastWidth;
+            startShape = lastShape;
+            lastShape = 0;
+        }
+    }
+
+    if (startShape < shapes.size()) {
+        lines.push_back({ startShape, shapes.size(),
+                          rangeAdvance(_line, startShape, shapes.size()) });
+    }
+    return lines;
+}
+
+static bool equal(const std::vector<LineRange>& a, const std::vector<LineRange>& b) {
+    if (a.size() != b.size()) { return false; }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].start != b[i].start || a[i].end != b[i].end || a[i].advance != b[i].advance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::mt19937 rng(3);
+
+    std::vector<LineRange> lines;
+
+    for (int i = 0; i < 5000; i++) {
+        LineLayout line = randomLine(rng);
+        float width = float(rng() % 200);
+
+        wrap(line, width, lines);
+        CHECK(equal(lines, reference(line, width)));
+    }
+
+    std::vector<WrapTrial> trials;
+
+    for (int i = 0; i < 2000; i++) {
+        LineLayout line = randomLine(rng);
+        if (i % 50 == 0) { line.setScale(0); }
+
+        std::vector<float> widths;
+        for (int k = 0, n = 1 + rng() % 5; k < n; k++) { widths.push_back(float(rng() % 300)); }
+
+        wrapTrials(line, widths, trials);
+
+        CHECK(trials.size() == widths.size());
+        for (size_t k = 0; k < widths.size() && k < trials.size(); k++) {
+            auto expected = reference(line, widths[k]);
+            CHECK(trials[k].maxWidth == widths[k]);
+            CHECK(equal(trials[k].lines, expected));
+
+            float width = 0;
+            for (auto& range : expected) { width = std::max(width, range.advance); }
+            CHECK(trials[k].size == glm::vec2(width, expected.size() * line.height()));
+        }
+    }
+
+    // Lines without break opportunity are not wrapped
+    LineLayout line(nullptr);
+    line.addShapes(std::vector<Shape>(10, Shape(0, 65, glm::vec2(0, 0), 10, 0)));
+    lines = wrap(line, 20);
+    CHECK(lines.size() == 1 && lines[0].start == 0 && lines[0].end == 10);
+
+    return TEST_RESULT();
+}
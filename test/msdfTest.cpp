@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// Compares multiChannelDistanceField() of synthetic outlines against the
+// FreeType coverage rasterizer and the distanceField() path.
+
+#include "alfons/msdf.h"
+#include "alfons/sdf.h"
+#include "test.h"
+
+#include FT_OUTLINE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace alfons;
+
+struct Point {
+    float x, y;
+    bool on;
+};
+
+// Outline from contours of points in pixels. Outer contours must be
+// clockwise (TrueType orientation).
+static void makeOutline(FT_Library _library, const std::vector<std::vector<Point>>& _contours,
+                        FT_Outline& _outline) {
+    size_t points = 0;
+    for (auto& contour : _contours) { points += contour.size(); }
+
+    FT_Outline_New(_library, points, _contours.size(), &_outline);
+
+    size_t n = 0;
+    for (size_t c = 0; c < _contours.size(); c++) {
+        for (auto& p : _contours[c]) {
+            _outline.points[n].x = FT_Pos(p.x * 64);
+            _outline.points[n].y = FT_Pos(p.y * 64);
+            _outline.tags[n] = p.on ? FT_CURVE_TAG_ON : FT_CURVE_TAG_CONIC;
+            n++;
+        }
+        _outline.contours[c] = short(n - 1);
+    }
+}
+
+// Render coverage of @outline into @coverage, same layout as GlyphBitmap
+static void renderCoverage(FT_Library _library, FT_Outline& _outline, GlyphBitmap& _coverage) {
+    FT_BBox box;
+    FT_Outline_Get_CBox(&_outline, &box);
+
+    int left = int(std::floor(box.xMin / 64.f));
+    int right = int(std::ceil(box.xMax / 64.f));
+    int bottom = int(std::floor(box.yMin / 64.f));
+    int top = int(std::ceil(box.yMax / 64.f));
+
+    _coverage.x0 = left;
+    _coverage.x1 = right;
+    _coverage.y0 = -top;
+    _coverage.y1 = -bottom;
+    _coverage.channels = 1;
+    _coverage.buffer.assign((right - left) * (top - bottom), 0);
+
+    FT_Bitmap bitmap = {};
+    bitmap.width = right - left;
+    bitmap.rows = top - bottom;
+    bitmap.pitch = right - left;
+    bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+    bitmap.num_grays = 256;
+    bitmap.buffer = _coverage.buffer.data();
+
+    FT_Outline_Translate(&_outline, -left * 64, -bottom * 64);
+    FT_Outline_Get_Bitmap(_library, &_outline, &bitmap);
+    FT_Outline_Translate(&_outline, left * 64, bottom * 64);
+}
+
+static int median(const unsigned char* p) {
+    return std::max(std::min(p[0], p[1]), std::min(std::max(p[0], p[1]), p[2]));
+}
+
+// Distances near corners are not compared: there the field holds the
+// distance to the extended edges
+static void testShape(FT_Library _library, const std::vector<std::vector<Point>>& _contours,
+                      bool _corners) {
+    const int spread = 4;
+
+    FT_Outline outline;
+    makeOutline(_library, _contours, outline);
+
+    GlyphBitmap field;
+    CHECK(multiChannelDistanceField(outline, spread, field));
+    CHECK(field.channels == 3);
+    CHECK(!field.empty);
+
+    GlyphBitmap coverage;
+    renderCoverage(_library, outline, coverage);
+
+    CHECK(field.width() == coverage.width() + 2 * spread);
+    CHECK(field.height() == coverage.height() + 2 * spread);
+
+    GlyphBitmap sdf;
+    distanceField(coverage, spread, sdf);
+
+    CHECK(sdf.width() == field.width());
+    CHECK(sdf.height() == field.height());
+
+    auto nearCorner = [&](float x, float y) {
+        if (!_corners) { return false; }
+        for (auto& contour : _contours) {
+            for (auto& p : contour) {
+                if (std::hypot(p.x - x, p.y - y) < spread) { return true; }
+            }
+        }
+        return false;
+    };
+
+    // Inside state must agree with coverage away from edges, distances
+    // with the coverage based field within a pixel
+    int mismatches = 0;
+    float maxError = 0;
+
+    for (int y = 0; y < field.height(); y++) {
+        for (int x = 0; x < field.width(); x++) {
+            int m = median(&field.buffer[(y * field.width() + x) * 3]);
+            int s = sdf.buffer[y * sdf.width() + x];
+
+            // Pixels in the clamped range carry no distance
+            if (m > 0 && m < 255 && s > 0 && s < 255 &&
+                !nearCorner(field.x0 + x + .5f, -(field.y0 + y + .5f))) {
+                maxError = std::max(maxError, std::abs(m - s) * spread / 127.f);
+            }
+
+            int cx = x - spread, cy = y - spread;
+            if (cx < 0 || cy < 0 || cx >= coverage.width() || cy >= coverage.height()) {
+                if (m >= 128) { mismatches++; }
+                continue;
+            }
+            int a = coverage.buffer[cy * coverage.width() + cx];
+            if (a > 64 && a < 192) { continue; }
+            if ((m >= 128) != (a >= 128)) { mismatches++; }
+        }
+    }
+
+    CHECK(mismatches == 0);
+    CHECK(maxError <= 1.f);
+
+    if (mismatches || maxError > 1.f) {
+        std::fprintf(stderr, "mismatches %d, max error %.2f px\n", mismatches, maxError);
+    }
+
+    FT_Outline_Done(_library, &outline);
+}
+
+int main() {
+    FT_Library library;
+    if (FT_Init_FreeType(&library) != 0) { return EXIT_FAILURE; }
+
+    // Square with a hole
+    testShape(library, {
+            { { 0, 0, true }, { 0, 20, true }, { 20, 20, true }, { 20, 0, true } },
+            { { 5, 5, true }, { 15, 5, true }, { 15, 15, true }, { 5, 15, true } } }, true);
+
+    // Circle of conic arcs
+    testShape(library, {
+            { { 14, 26, true }, { 26, 26, false }, { 26, 14, true }, { 26, 2, false },
+              { 14, 2, true }, { 2, 2, false }, { 2, 14, true }, { 2, 26, false } } }, false);
+
+    // Sharp corners
+    testShape(library, {
+            { { 0, 0, true }, { 10, 30, true }, { 20, 0, true } } }, true);
+
+    // Outline without contours renders as empty
+    FT_Outline outline;
+    FT_Outline_New(library, 0, 0, &outline);
+    GlyphBitmap field;
+    CHECK(!multiChannelDistanceField(outline, 4, field));
+    CHECK(field.empty);
+    FT_Outline_Done(library, &outline);
+
+    FT_Done_FreeType(library);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// QuadMatrix::transformRects() of random rects, with and without
+// placement and clipping, against transformRect() of each rect.
+
+#include "alfons/quadMatrix.h"
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace alfons;
+
+static float difference(const Quad& a, const Quad& b) {
+    const float* p = &a.x1;
+    const float* q = &b.x1;
+    float d = 0;
+    for (int i = 0; i < 8; i++) { d = std::max(d, std::abs(p[i] - q[i])); }
+    return d;
+}
+
+// Same test as TextBatch::clip()
+static bool outside(const Quad& q, const Rect& clip) {
+    return (std::min({ q.x1, q.x2, q.x3, q.x4 }) > clip.x2 ||
+            std::min({ q.y1, q.y2, q.y3, q.y4 }) > clip.y2 ||
+            std::max({ q.x1, q.x2, q.x3, q.x4 }) < clip.x1 ||
+            std::max({ q.y1, q.y2, q.y3, q.y4 }) < clip.y1);
+}
+
+// Quad of rect @i in @rects by transformRect(), placement applied first
+static Quad reference(const QuadMatrix& _matrix, const RectBatch& _rects, size_t _i) {
+    Rect rect{ _rects.x1[_i], _rects.y1[_i], _rects.x2[_i], _rects.y2[_i] };
+    Quad quad;
+
+    if (!_rects.hasPlacement()) {
+        _matrix.transformRect(rect, quad);
+        return quad;
+    }
+
+    QuadMatrix placement;
+    placement.setTranslation(_rects.tx[_i], _rects.ty[_i]);
+    placement.rotateZ(std::atan2(_rects.s[_i], _rects.c[_i]));
+    placement.transformRect(rect, quad);
+
+    glm::vec3 p1 = _matrix.transform(quad.x1, quad.y1);
+    glm::vec3 p2 = _matrix.transform(quad.x2, quad.y2);
+    glm::vec3 p3 = _matrix.transform(quad.x3, quad.y3);
+    glm::vec3 p4 = _matrix.transform(quad.x4, quad.y4);
+
+    return { p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, p4.x, p4.y };
+}
+
+static void testBatch(std::mt19937& _rng, size_t _count, bool _placed) {
+    std::uniform_real_distribution<float> position(-500, 500);
+    std::uniform_real_distribution<float> size(1, 40);
+    std::uniform_real_distribution<float> angle(0, 6.283f);
+
+    RectBatch rects;
+    for (size_t i = 0; i < _count; i++) {
+        float x = position(_rng), y = position(_rng);
+        Rect rect{ x, y, x + size(_rng), y + size(_rng) };
+        if (_placed) {
+            float a = angle(_rng);
+            rects.add(rect, std::cos(a), std::sin(a), position(_rng), position(_rng));
+        } else {
+            rects.add(rect);
+        }
+    }
+
+    QuadMatrix matrix;
+    matrix.translate(30, -20);
+    matrix.rotateZ(angle(_rng));
+    matrix.scale(1.5f);
+
+    std::vector<Quad> all(_count), kept(_count);
+    std::vector<uint32_t> indices(_count);
+
+    matrix.transformRects(rects, all.data());
+
+    Rect clip{ -200, -150, 250, 300 };
+    size_t keptCount = matrix.transformRects(rects, clip, kept.data(), indices.data());
+
+    // Kept quads in the order of @rects
+    size_t k = 0;
+    for (size_t i = 0; i < _count; i++) {
+        Quad quad = reference(matrix, rects, i);
+        CHECK(difference(quad, all[i]) < 1e-3f);
+
+        if (outside(quad, clip)) { continue; }
+
+        CHECK(k < keptCount);
+        if (k < keptCount) {
+            CHECK(indices[k] == i);
+            CHECK(difference(quad, kept[k]) < 1e-3f);
+        }
+        k++;
+    }
+    CHECK(k == keptCount);
+}
+
+int main() {
+    std::mt19937 rng(1);
+
+    // Counts that are not a multiple of the vector width
+    for (size_t count : { 0, 1, 3, 4, 7, 1003 }) {
+        testBatch(rng, count, false);
+        testBatch(rng, count, true);
+    }
+
+    return TEST_RESULT();
+}
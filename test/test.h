@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal checks for the test executables: Failures are reported and
+// make main() return non-zero via TEST_RESULT.
+
+static int testFailures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n",           \
+                         __FILE__, __LINE__, #cond);                    \
+            testFailures++;                                             \
+        }                                                               \
+    } while (0)
+
+#define TEST_RESULT() (testFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Minimal TrueType font built in memory, so that tests need no font files.
+// 1000 units per em, ascender 800, descender -200. Glyph 0 is an empty
+// .notdef, glyph 1 the space, glyphs 2-27 and 28-53 are filled boxes of
+// different sizes for 'A'-'Z' and 'a'-'z' (see testGlyphBox).
+
+struct TestGlyphBox {
+    // Outline bounds in font units, y up
+    int x0, y0, x1, y1;
+    int advance;
+};
+
+// Box of glyph @gid, empty for .notdef and space
+inline TestGlyphBox testGlyphBox(int gid) {
+    if (gid < 2) { return { 0, 0, 0, 0, gid == 1 ? 250 : 500 }; }
+
+    int i = gid - 2;
+    int x0 = 40 + (i * 13) % 60;
+    int y0 = -(i % 5) * 50;
+    int x1 = x0 + 150 + (i * 97) % 500;
+    int y1 = y0 + 250 + (i * 53) % 500;
+    return { x0, y0, x1, y1, x1 + 60 };
+}
+
+inline std::vector<char> testFont() {
+    const int glyphs = 54;
+
+    struct Writer {
+        std::vector<char> data;
+        void u8(int v) { data.push_back(char(v)); }
+        void u16(int v) { u8(v >> 8 & 0xff); u8(v & 0xff); }
+        void u32(uint32_t v) { u16(int(v >> 16)); u16(int(v & 0xffff)); }
+        void pad() { while (data.size() % 4) { u8(0); } }
+    };
+
+    Writer glyf, loca, hmtx;
+    int xMin = 0, yMin = 0, xMax = 0, yMax = 0, advanceMax = 0;
+
+    for (int gid = 0; gid < glyphs; gid++) {
+        TestGlyphBox b = testGlyphBox(gid);
+        loca.u32(uint32_t(glyf.data.size()));
+        hmtx.u16(b.advance);
+        hmtx.u16(b.x0);
+        advanceMax = std::max(advanceMax, b.advance);
+
+        if (b.x1 == b.x0) { continue; }
+
+        xMin = std::min(xMin, b.x0);
+        yMin = std::min(yMin, b.y0);
+        xMax = std::max(xMax, b.x1);
+        yMax = std::max(yMax, b.y1);
+
+        // One clockwise contour of on-curve points with word deltas
+        glyf.u16(1);
+        glyf.u16(b.x0); glyf.u16(b.y0); glyf.u16(b.x1); glyf.u16(b.y1);
+        glyf.u16(3);
+        glyf.u16(0);
+        for (int p = 0; p < 4; p++) { glyf.u8(1); }
+        glyf.u16(b.x0); glyf.u16(0); glyf.u16(b.x1 - b.x0); glyf.u16(0);
+        glyf.u16(b.y0); glyf.u16(b.y1 - b.y0); glyf.u16(0); glyf.u16(b.y0 - b.y1);
+        glyf.pad();
+    }
+    loca.u32(uint32_t(glyf.data.size()));
+
+    // Format 4: space, 'A'-'Z', 'a'-'z' and the final segment
+    Writer cmap;
+    const int segments[][3] = { { 32, 32, 1 }, { 65, 90, 2 }, { 97, 122, 28 }, { 0xffff, 0xffff, 0 } };
+    const int segCount = 4;
+    cmap.u16(0); cmap.u16(1);
+    cmap.u16(3); cmap.u16(1); cmap.u32(12);
+    cmap.u16(4); cmap.u16(16 + 8 * segCount); cmap.u16(0);
+    cmap.u16(segCount * 2); cmap.u16(8); cmap.u16(2); cmap.u16(0);
+    for (auto& s : segments) { cmap.u16(s[1]); }
+    cmap.u16(0);
+    for (auto& s : segments) { cmap.u16(s[0]); }
+    for (auto& s : segments) { cmap.u16(s[0] == 0xffff ? 1 : (s[2] - s[0]) & 0xffff); }
+    for (int i = 0; i < segCount; i++) { cmap.u16(0); }
+
+    Writer head;
+    head.u32(0x00010000); head.u32(0x00010000); head.u32(0); head.u32(0x5F0F3CF5);
+    head.u16(0x000B); head.u16(1000);
+    for (int i = 0; i < 4; i++) { head.u32(0); }
+    head.u16(xMin); head.u16(yMin); head.u16(xMax); head.u16(yMax);
+    head.u16(0); head.u16(8); head.u16(2); head.u16(1); head.u16(0);
+
+    Writer hhea;
+    hhea.u32(0x00010000); hhea.u16(800); hhea.u16(-200); hhea.u16(0);
+    hhea.u16(advanceMax); hhea.u16(0); hhea.u16(0); hhea.u16(xMax);
+    hhea.u16(1); hhea.u16(0); hhea.u16(0);
+    for (int i = 0; i < 4; i++) { hhea.u16(0); }
+    hhea.u16(0); hhea.u16(glyphs);
+
+    Writer maxp;
+    maxp.u32(0x00010000); maxp.u16(glyphs); maxp.u16(4); maxp.u16(1);
+    maxp.u16(0); maxp.u16(0); maxp.u16(2);
+    for (int i = 0; i < 9; i++) { maxp.u16(0); }
+
+    // Family and style name, UTF-16BE
+    Writer name;
+    const char* names[] = { "Test", "Regular" };
+    name.u16(0); name.u16(2); name.u16(6 + 2 * 12);
+    for (int id = 0, offset = 0; id < 2; offset += 2 * int(strlen(names[id])), id++) {
+        name.u16(3); name.u16(1); name.u16(0x409); name.u16(id + 1);
+        name.u16(2 * int(strlen(names[id]))); name.u16(offset);
+    }
+    for (auto n : names) {
+        for (const char* c = n; *c; c++) { name.u16(*c); }
+    }
+
+    Writer post;
+    post.u32(0x00030000); post.u32(0); post.u16(-100); post.u16(50);
+    for (int i = 0; i < 5; i++) { post.u32(0); }
+
+    struct Table {
+        const char* tag;
+        Writer* data;
+    } tables[] = { { "cmap", &cmap }, { "glyf", &glyf }, { "head", &head },
+                   { "hhea", &hhea }, { "hmtx", &hmtx }, { "loca", &loca },
+                   { "maxp", &maxp }, { "name", &name }, { "post", &post } };
+    const int count = 9;
+
+    Writer font;
+    font.u32(0x00010000); font.u16(count); font.u16(128); font.u16(3); font.u16(count * 16 - 128);
+
+    uint32_t offset = 12 + 16 * count;
+    for (auto& table : tables) {
+        table.data->pad();
+        auto& d = table.data->data;
+
+        uint32_t sum = 0;
+        for (size_t i = 0; i < d.size(); i += 4) {
+            sum += uint32_t(uint8_t(d[i])) << 24 | uint32_t(uint8_t(d[i + 1])) << 16 |
+                uint32_t(uint8_t(d[i + 2])) << 8 | uint8_t(d[i + 3]);
+        }
+        for (int i = 0; i < 4; i++) { font.u8(table.tag[i]); }
+        font.u32(sum);
+        font.u32(offset);
+        font.u32(uint32_t(d.size()));
+        offset += uint32_t(d.size());
+    }
+    for (auto& table : tables) {
+        font.data.insert(font.data.end(), table.data->data.begin(), table.data->data.end());
+    }
+    return font.data;
+}
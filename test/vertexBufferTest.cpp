@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2015, Hannes Janetzek
+ *
+ * The following source-code is distributed under the Simplified BSD License.
+ */
+
+// VertexBuffer page ranges against the pages of the written glyphs, with
+// the default vertex format and a full buffer.
+
+#include "alfons/vertexBuffer.h"
+#include "test.h"
+
+#include <random>
+#include <vector>
+
+using namespace alfons;
+
+int main() {
+    std::mt19937 rng(7);
+
+    VertexFormat format;
+    CHECK(format.stride == 12 && format.page == -1);
+
+    const size_t glyphs = 500;
+    std::vector<unsigned char> data(4 * glyphs * format.stride);
+    VertexBuffer buffer(format, data.data(), 4 * glyphs);
+
+    Glyph glyph(0, 0, 8, 8, glm::vec2(0, 0), glm::vec2(8, 8));
+    std::vector<AtlasID> pages;
+
+    for (size_t i = 0; i < glyphs + 10; i++) {
+        // Mostly runs of the same page
+        AtlasID page = pages.empty() || rng() % 4 == 0 ? AtlasID(rng() % 3) : pages.back();
+        if (buffer.addGlyph(Rect{ 0, 0, 8, 8 }, glyph, page)) { pages.push_back(page); }
+    }
+    CHECK(pages.size() == glyphs);
+    CHECK(buffer.count == 4 * glyphs && buffer.dropped == 10);
+
+    // Ranges cover the buffer in order and each holds glyphs of its page
+    size_t next = 0;
+    std::vector<uint32_t> perPage(3);
+    for (auto& range : buffer.pageRanges) {
+        CHECK(range.first == next && range.count > 0);
+        for (size_t i = range.first; i < range.first + range.count; i++) {
+            CHECK(pages[i] == range.page);
+        }
+        if (next > 0) { CHECK(pages[next - 1] != range.page); }
+        perPage[range.page] += uint32_t(range.count);
+        next = range.first + range.count;
+    }
+    CHECK(next == glyphs);
+    CHECK(buffer.pageGlyphs.size() <= 3);
+    for (size_t p = 0; p < buffer.pageGlyphs.size(); p++) {
+        CHECK(buffer.pageGlyphs[p] == perPage[p]);
+    }
+
+    buffer.reset();
+    CHECK(buffer.pageRanges.empty() && buffer.count == 0);
+
+    return TEST_RESULT();
+}